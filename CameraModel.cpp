@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#include "CameraModel.hpp"
+
+CameraModel::CameraModel() : K(Matx33d::eye()), Kinv(Matx33d::eye()), P(Matx34d::eye()), KP(Matx34d::eye()) {
+}
+
+CameraModel::CameraModel(const Matx33d &K) : P(Matx34d::eye()) {
+    setIntrinsics(K);
+}
+
+CameraModel::CameraModel(const Matx33d &K, const Matx34d &P) : P(P) {
+    setIntrinsics(K);
+}
+
+CameraModel::CameraModel(const Matx33d &K, const Matx33d &R, const Matx31d &t) : P(poseMatrix(R, t)) {
+    setIntrinsics(K);
+}
+
+void CameraModel::setIntrinsics(const Matx33d &K) {
+    this->K = K;
+    Kinv = K.inv();
+    KP = K*P;
+}
+
+void CameraModel::setPose(const Matx34d &P) {
+    this->P = P;
+    KP = K*P;
+}
+
+void CameraModel::setPose(const Matx33d &R, const Matx31d &t) {
+    setPose(poseMatrix(R, t));
+}
+
+Matx34d CameraModel::poseMatrix(const Matx33d &R, const Matx31d &t) {
+    return Matx34d(R(0,0), R(0,1), R(0,2), t(0), R(1,0), R(1,1), R(1,2), t(1), R(2,0), R(2,1), R(2,2), t(2));
+}
+
+Point2d CameraModel::projectPoint(const Matx31d &pt3D) const {
+    return projectPoint(pt3D.val);
+}
+
+Point2d CameraModel::projectPoint(const double *pt3D) const {
+    double x = pt3D[0], y = pt3D[1], z = pt3D[2];
+    double px = KP(0,0)*x + KP(0,1)*y + KP(0,2)*z + KP(0,3);
+    double py = KP(1,0)*x + KP(1,1)*y + KP(1,2)*z + KP(1,3);
+    double iz = 1.0/(KP(2,0)*x + KP(2,1)*y + KP(2,2)*z + KP(2,3));
+    return Point2d(px*iz, py*iz);
+}
+
+bool CameraModel::projectIfVisible(const double *pt3D, const Size &imSize, Point2d &pt2D) const {
+    
+    //depth along the optical axis
+    double x = pt3D[0], y = pt3D[1], z = pt3D[2];
+    if (P(2,0)*x + P(2,1)*y + P(2,2)*z + P(2,3) <= 0)
+        return false;
+    
+    pt2D = projectPoint(pt3D);
+    return (pt2D.x >= 0) && (pt2D.x < imSize.width) && (pt2D.y >= 0) && (pt2D.y < imSize.height);
+}
+
+void CameraModel::projectPoints(const vector<Matx31d> &pts3D, vector<Point2d> &pts2D, Size imSize) const {
+    
+    if ((imSize.width == 0) && (imSize.height == 0)) {
+        //preallocate for speed
+        size_t offset = pts2D.size();
+        pts2D.resize(offset + pts3D.size());
+        if (pts3D.size())
+            projectPoints(pts3D[0].val, pts3D.size(), &pts2D[offset]);
+    } else {
+        for (size_t i = 0; i < pts3D.size(); i++) {
+            Point2d pt2d = projectPoint(pts3D[i].val);
+            if ((pt2d.x >= 0) && (pt2d.x < imSize.width) && (pt2d.y >= 0) && (pt2d.y < imSize.height))
+                pts2D.push_back(pt2d);
+        }
+    }
+}
+
+void CameraModel::projectPoints(const vector<Matx31d> &pts3D, vector<Point2i> &pts2D, Size imSize) const {
+    
+    if ((imSize.width == 0) && (imSize.height == 0)) {
+        for (size_t i = 0; i < pts3D.size(); i++)
+            pts2D.push_back(projectPoint(pts3D[i].val));
+    } else {
+        for (size_t i = 0; i < pts3D.size(); i++) {
+            Point2d pt = projectPoint(pts3D[i].val);
+            Point2i pt2d = Point2i(round(pt.x),round(pt.y));
+            if ((pt2d.x >= 0) && (pt2d.x < imSize.width) && (pt2d.y >= 0) && (pt2d.y < imSize.height))
+                pts2D.push_back(pt2d);
+        }
+    }
+}
+
+void CameraModel::projectPoints(const double *pts3D, size_t n, Point2d *pts2D) const {
+    for (size_t i = 0; i < n; i++)
+        pts2D[i] = projectPoint(pts3D + 3*i);
+}
+
+Point2d CameraModel::normalisePoint(const Point2d &pt) const {
+    double x = Kinv(0,0)*pt.x + Kinv(0,1)*pt.y + Kinv(0,2);
+    double y = Kinv(1,0)*pt.x + Kinv(1,1)*pt.y + Kinv(1,2);
+    double w = Kinv(2,0)*pt.x + Kinv(2,1)*pt.y + Kinv(2,2);
+    return Point2d(x/w, y/w);
+}
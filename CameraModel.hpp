@@ -0,0 +1,74 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef CameraModel_hpp
+#define CameraModel_hpp
+
+#include <stdio.h>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+//Pinhole camera with intrinsics K and pose P = [R|t] (world to camera). K*P and K.inv() are computed once when the
+//intrinsics or the pose change, so projecting points one at a time does not redo them on every call
+class CameraModel {
+    
+public:
+    CameraModel();
+    CameraModel(const Matx33d &K);
+    CameraModel(const Matx33d &K, const Matx34d &P);
+    CameraModel(const Matx33d &K, const Matx33d &R, const Matx31d &t);
+    
+    //setters refresh the cached products
+    void setIntrinsics(const Matx33d &K);
+    void setPose(const Matx34d &P);
+    void setPose(const Matx33d &R, const Matx31d &t);
+    
+    const Matx33d &getK() const { return K; }
+    const Matx33d &getKinv() const { return Kinv; }
+    const Matx34d &getP() const { return P; }
+    const Matx34d &getKP() const { return KP; }
+    
+    //projection
+    Point2d projectPoint(const Matx31d &pt3D) const;
+    Point2d projectPoint(const double *pt3D) const;
+    //projects pt3D to pt2D, returns false if it is not in front of the camera or falls outside an image of size imSize
+    bool projectIfVisible(const double *pt3D, const Size &imSize, Point2d &pt2D) const;
+    //same behaviour as GeometryUtils::projectPoints: appends the projections, only those inside the image if imSize is given
+    void projectPoints(const vector<Matx31d> &pts3D, vector<Point2d> &pts2D, Size imSize = Size(0,0)) const;
+    void projectPoints(const vector<Matx31d> &pts3D, vector<Point2i> &pts2D, Size imSize = Size(0,0)) const;
+    //projects n points stored contiguously as x,y,z triples to a caller buffer of n points
+    void projectPoints(const double *pts3D, size_t n, Point2d *pts2D) const;
+    
+    //normalised coordinates K.inv()*[pt 1] of an image point
+    Point2d normalisePoint(const Point2d &pt) const;
+    
+    //[R|t] assembled in one step
+    static Matx34d poseMatrix(const Matx33d &R, const Matx31d &t);
+    
+private:
+    Matx33d K, Kinv;
+    Matx34d P, KP;
+};
+
+#endif /* CameraModel_hpp */
@@ -24,145 +24,147 @@
 
 
 
-Mat Display2D::displayFeaturesOnFrame(const cv::Mat &img, const vector<Point2d> &pts, int radius, Scalar colour, float scale) {
+//fractional bits of the coordinates passed to the OpenCV drawing functions
+static const int kDrawShift = DrawList::shift;
+static const double kDrawOne = 1 << kDrawShift;
 
-    //set input
-    Mat dShow;
-    if (img.channels() == 3)
-        dShow = img.clone();
-    else
-        cvtColor(img,dShow,CV_GRAY2BGR);
-    
-    //draw matches
-    for (int i = 0; i < pts.size(); i++) {
-        if ((pts[i].x >= 0) && (pts[i].x < dShow.cols) && (pts[i].y >= 0) && (pts[i].y < dShow.rows)) {
-            circle(dShow, pts[i], radius, colour, -1, CV_AA);
-        }
-    }
-    
-    //scale down
-    Mat dShow_small;
-    resize(dShow, dShow_small, Size(round(scale*dShow.cols), round(scale*dShow.rows)));
+//fixed point canvas coordinates of a full resolution point, mapping pixel centres the way resize does
+template <typename T>
+static inline Point toCanvas(const Point_<T> &pt, double scale, double offsetX = 0) {
+    return Point(cvRound(((pt.x + 0.5)*scale - 0.5 + offsetX)*kDrawOne), cvRound(((pt.y + 0.5)*scale - 0.5)*kDrawOne));
+}
 
-    return dShow_small;
+static inline int toCanvasRadius(double radius, double scale) {
+    return max(1, cvRound(radius*scale*kDrawOne));
 }
 
-Mat Display2D::displayFeaturesOnFrame(const cv::Mat &img, const vector<Point2f> &pts, int radius, Scalar colour, float scale) {
-    
-    //set input
-    Mat dShow;
-    if (img.channels() == 3)
-        dShow = img.clone();
-    else
-        cvtColor(img,dShow,CV_GRAY2BGR);
-    
-    //draw matches
-    for (int i = 0; i < pts.size(); i++) {
-        if ((pts[i].x >= 0) && (pts[i].x < dShow.cols) && (pts[i].y >= 0) && (pts[i].y < dShow.rows)) {
-            circle(dShow, pts[i], radius, colour, -1, CV_AA);
-        }
-    }
-    
-    //scale down
-    Mat dShow_small;
-    resize(dShow, dShow_small, Size(round(scale*dShow.cols), round(scale*dShow.rows)));
-    
-    return dShow_small;
+static inline int toCanvasThickness(int thickness, double scale) {
+    return max(1, cvRound(thickness*scale));
 }
 
-Mat Display2D::displayFeatureMatches(const cv::Mat &img0, const cv::Mat &img1, const vector<Point2d> &pts0, const vector<Point2d> &pts1, int radius, Scalar colour, float scale) {
-    
-    //build match structure
-    vector<DMatch> matches;
-    vector<KeyPoint> k0, k1;
-    for (int i = 0; i < pts0.size(); i++) {
-        matches.push_back(DMatch(i,i,0));
-        k0.push_back(KeyPoint(pts0[i], 0));
-        k1.push_back(KeyPoint(pts1[i], 0));
+//the render functions draw either immediately on a canvas or into a draw list, through one of these targets
+struct CanvasTarget {
+    Mat &canvas;
+    CanvasTarget(Mat &canvas) : canvas(canvas) {}
+    Size size() const { return canvas.size(); }
+    void drawCircle(const Point &centre, int radius, const Scalar &colour, int thickness, int lineType) {
+        circle(canvas, centre, radius, colour, thickness, lineType, kDrawShift);
     }
+    void drawLine(const Point &p0, const Point &p1, const Scalar &colour, int thickness, int lineType) {
+        line(canvas, p0, p1, colour, thickness, lineType, kDrawShift);
+    }
+};
 
-    
-    //draw matches
-    Mat dShow;
-    drawMatches(img0, k0, img1, k1, matches, dShow, colour);
+//region of a draw list canvas starting origin pixels to the right
+struct ListTarget {
+    DrawList &list;
+    Point origin;
+    Size viewSize;
+    ListTarget(DrawList &list, int originX = 0, int width = -1) : list(list), origin(originX << kDrawShift, 0),
+        viewSize((width < 0) ? list.canvasSize().width : width, list.canvasSize().height) {}
+    Size size() const { return viewSize; }
+    void drawCircle(const Point &centre, int radius, const Scalar &colour, int thickness, int lineType) {
+        list.addCircle(centre + origin, radius, colour, thickness, lineType);
+    }
+    void drawLine(const Point &p0, const Point &p1, const Scalar &colour, int thickness, int lineType) {
+        list.addLine(p0 + origin, p1 + origin, colour, thickness, lineType);
+    }
+};
 
-    //scale down
-    Mat dShow_small;
-    resize(dShow, dShow_small, Size(round(scale*dShow.cols), round(scale*dShow.rows)));
-    
-    return dShow_small;
+//draws into the part of the frame present in the canvas
+template <typename T>
+static inline bool insideCanvas(const Point_<T> &pt, const Size &size, double scale) {
+    return (pt.x >= 0) && (pt.x*scale < size.width) && (pt.y >= 0) && (pt.y*scale < size.height);
 }
 
-Mat Display2D::displayFeatureMatches(const cv::Mat &img0, const cv::Mat &img1, const vector<Point2f> &pts0, const vector<Point2f> &pts1, int radius, Scalar colour, float scale) {
-    
-    //build match structure
-    vector<DMatch> matches;
-    vector<KeyPoint> k0, k1;
-    for (int i = 0; i < pts0.size(); i++) {
-        matches.push_back(DMatch(i,i,0));
-        k0.push_back(KeyPoint(pts0[i], 0));
-        k1.push_back(KeyPoint(pts1[i], 0));
-    }
-    
+void Display2D::selectMatches(size_t nMatches, int step, vector<int> &idx) {
     
-    //draw matches
-    Mat dShow;
-    drawMatches(img0, k0, img1, k1, matches, dShow, colour);
-    
-    //scale down
-    Mat dShow_small;
-    resize(dShow, dShow_small, Size(round(scale*dShow.cols), round(scale*dShow.rows)));
-    
-    return dShow_small;
+    idx.clear();
+    step = max(step, 1);
+    idx.reserve((nMatches + step - 1)/step);
+    for (size_t i = 0; i < nMatches; i += step)
+        idx.push_back((int)i);
 }
 
+void Display2D::selectMatches(const vector<double> &residuals, int topK, vector<int> &idx) {
+    
+    int n = (int)residuals.size();
+    idx.resize(n);
+    for (int i = 0; i < n; i++)
+        idx[i] = i;
+    if ((topK <= 0) || (topK >= n))
+        return;
+    
+    //partial selection of the lowest residuals, drawn in input order
+    nth_element(idx.begin(), idx.begin() + topK, idx.end(), [&residuals](int a, int b) { return residuals[a] < residuals[b]; });
+    idx.resize(topK);
+    sort(idx.begin(), idx.end());
+}
 
-Mat Display2D::display3DProjections(const cv::Mat &img, const Matx33d &K, const Matx33d &R, const Matx31d &t, const vector<Matx31d> &pts, int radius, Scalar colour, float scale) {
+void Display2D::prepareCanvas(const Mat &img, Mat &canvas, float scale) {
     
-    //set input
-    Mat dShow;
+    Size size(round(scale*img.cols), round(scale*img.rows));
     if (img.channels() == 3)
-        dShow = img.clone();
-    else
-        cvtColor(img,dShow,CV_GRAY2BGR);
-    
-    //build projection matrix
-    Matx34d P(R(0,0), R(0,1), R(0,2), t(0), R(1,0), R(1,1), R(1,2), t(1), R(2,0), R(2,1), R(2,2), t(2));
-
-    //project points and draw
-    vector<Point2d> pts2D;
-    for (int i = 0; i < pts.size(); i++) {
-        Matx41d pt3D(pts[i](0),pts[i](1),pts[i](2),1);
-        Matx31d ptn = P*pt3D;
-        ptn *= 1.0/ptn(2);
-        Matx31d pt2D = K*ptn;
-        pt2D *= 1.0/pt2D(2);
-        //check boundaries
-        if ((pt2D(0) >= 0) && (pt2D(0) < img.cols) && (pt2D(1) >= 0) && (pt2D(1) < img.rows)) {
-            pts2D.push_back(Point2d(pt2D(0),pt2D(1)));
-            circle(dShow, Point2d(pt2D(0),pt2D(1)), radius, colour, -1, CV_AA );
-        } 
+        resize(img, canvas, size);
+    else {
+        //convert after downscaling
+        Mat small;
+        resize(img, small, size);
+        cvtColor(small, canvas, CV_GRAY2BGR);
     }
-    
-    //scale down
-    Mat dShow_small;
-    resize(dShow, dShow_small, Size(round(scale*dShow.cols), round(scale*dShow.rows)));
-    
-    return dShow_small;
 }
 
-Mat Display2D::displayEpipolarLines(const cv::Mat &img0, const cv::Mat &img1, const Matx33d &F, const vector<Point2d> pts, int pts0or1, int nFeatures, int radius, Scalar colour, float scale) {
-    
-    //prepare input
-    Mat dShow0, dShow1, dShow;
-    if (img0.channels() == 3) {
-        dShow0 = img0.clone();
-        dShow1 = img1.clone();
+void Display2D::prepareCanvas(const Mat &img0, const Mat &img1, Mat &canvas, Mat &view0, Mat &view1, float scale) {
+    
+    Size size0(round(scale*img0.cols), round(scale*img0.rows)), size1(round(scale*img1.cols), round(scale*img1.rows));
+    canvas.create(max(size0.height, size1.height), size0.width + size1.width, CV_8UC3);
+    if (size0.height != size1.height)
+        canvas.setTo(Scalar::all(0));
+    
+    //the views share the canvas memory, so preparing them fills the canvas
+    view0 = canvas(Rect(0, 0, size0.width, size0.height));
+    view1 = canvas(Rect(size0.width, 0, size1.width, size1.height));
+    prepareCanvas(img0, view0, scale);
+    prepareCanvas(img1, view1, scale);
+}
+
+template <typename Target, typename T>
+static void renderFeaturesTo(Target &target, const vector<Point_<T> > &pts, double scale, int radius, const Scalar &colour) {
+    Size size = target.size();
+    int r = toCanvasRadius(radius, scale);
+    for (size_t i = 0; i < pts.size(); i++) {
+        if (insideCanvas(pts[i], size, scale))
+            target.drawCircle(toCanvas(pts[i], scale), r, colour, -1, CV_AA);
     }
-    else {
-        cvtColor(img0,dShow0,CV_GRAY2BGR);
-        cvtColor(img1,dShow1,CV_GRAY2BGR);
+}
+
+template <typename Target, typename T>
+static void renderMatchesTo(Target &target, const vector<Point_<T> > &pts0, const vector<Point_<T> > &pts1, const vector<int> *idx, int width0, double scale, int radius, const Scalar &colour) {
+    
+    double offset = round(scale*width0);
+    int r = toCanvasRadius(radius, scale);
+    size_t n = (idx == NULL) ? pts0.size() : idx->size();
+    for (size_t k = 0; k < n; k++) {
+        int i = (idx == NULL) ? (int)k : (*idx)[k];
+        Point p0 = toCanvas(pts0[i], scale), p1 = toCanvas(pts1[i], scale, offset);
+        target.drawCircle(p0, r, colour, 1, CV_AA);
+        target.drawCircle(p1, r, colour, 1, CV_AA);
+        target.drawLine(p0, p1, colour, 1, CV_AA);
     }
+}
+
+template <typename Target>
+static void renderProjectionsTo(Target &target, const CameraModel &cam, const PointCloud3::View &pts, double scale, int radius, const Scalar &colour) {
+    
+    //project points inside the frame and draw
+    vector<Point2d> pts2D;
+    Size size = target.size();
+    GeometryUtils::projectPoints(cam, pts, pts2D, Size(ceil(size.width/scale), ceil(size.height/scale)));
+    renderFeaturesTo(target, pts2D, scale, radius, colour);
+}
+
+template <typename Target>
+static void renderEpipolarLinesTo(Target &view0, Target &view1, const Matx33d &F, const vector<Point2d> &pts, int pts0or1, int nFeatures, double scale, int radius, const Scalar &colour) {
     
     //compute epipolar lines
     vector<Vec3d> epiLines;
@@ -171,87 +173,209 @@ Mat Display2D::displayEpipolarLines(const cv::Mat &img0, const cv::Mat &img1, co
     else
         computeCorrespondEpilines(pts, 2, F, epiLines);
     
-    //draw epilines
-    if (nFeatures <= 0)
-        nFeatures = pts.size();
-    
+    //draw epilines across the other view
+    if ((nFeatures <= 0) || (nFeatures > (int)pts.size()))
+        nFeatures = (int)pts.size();
+    Target &ptView = (pts0or1 == 0) ? view0 : view1;
+    Target &lineView = (pts0or1 == 0) ? view1 : view0;
+    double width = ceil(lineView.size().width/scale);
+    int r = toCanvasRadius(radius, scale);
     for (int i = 0; i < nFeatures; i++) {
-        
-        if (pts0or1 == 0) {
-            //draw feature
-            circle(dShow0,pts[i],radius,colour,-1,CV_AA);
-            //draw corresponding epiline
-            line(dShow1, Point2d(0,-epiLines[i][2]/epiLines[i][1]),Point2d(dShow1.cols,-(epiLines[i][0]*dShow1.cols + epiLines[i][2])/epiLines[i][1]),colour,1,CV_AA);
-        }
-        else {
-            //draw feature
-            circle(dShow1,pts[i],radius,colour,-1,CV_AA);
-            //draw corresponding epiline
-            line(dShow0, Point2d(0,-epiLines[i][2]/epiLines[i][1]),Point2d(dShow1.cols,-(epiLines[i][0]*dShow1.cols + epiLines[i][2])/epiLines[i][1]),colour,1,CV_AA);
-        }
+        ptView.drawCircle(toCanvas(pts[i], scale), r, colour, -1, CV_AA);
+        Point2d a(0, -epiLines[i][2]/epiLines[i][1]), b(width, -(epiLines[i][0]*width + epiLines[i][2])/epiLines[i][1]);
+        lineView.drawLine(toCanvas(a, scale), toCanvas(b, scale), colour, 1, CV_AA);
     }
-    
-    //concatenate images
-    hconcat(dShow0,dShow1,dShow);
-    
-    //scale down
-    Mat dShow_small;
-    resize(dShow, dShow_small, Size(round(scale*dShow.cols), round(scale*dShow.rows)));
-    
-    return dShow_small;
 }
 
-
-Mat Display2D::drawCubeWireframe(const Mat &img, const Matx33d &K, const Matx34d &P, const vector<Matx31d> &frontFace, const vector<Matx31d> &backFace, int thickness, Scalar colour, float scale) {
-    
-    //set input
-    Mat dShow;
-    if (img.channels() == 3)
-        dShow = img.clone();
-    else
-        cvtColor(img,dShow,CV_GRAY2BGR);
+template <typename Target>
+static void renderCubeWireframeTo(Target &target, const Matx33d &K, const Matx34d &P, const vector<Matx31d> &frontFace, const vector<Matx31d> &backFace, double scale, int thickness, const Scalar &colour) {
     
-    if ((frontFace.size() == 4) && (backFace.size() == 4)) {
-        //project cube points onto image plane
-        vector<Point2d> front2D, back2D;
-        GeometryUtils::projectPoints(P, K, frontFace, front2D);
-        GeometryUtils::projectPoints(P, K, backFace, back2D);
+    if ((frontFace.size() != 4) || (backFace.size() != 4))
+        return;
     
-        //display lines
-        for (int i = 0; i < 4; i++) {
-            int nextPtIdx = (i+1) % 4;
-            line(dShow, front2D[i], front2D[nextPtIdx], colour, thickness, CV_AA);
-            line(dShow, back2D[i], back2D[nextPtIdx], colour, thickness, CV_AA);
-            line(dShow, front2D[i], back2D[i], colour, thickness, CV_AA);
-        }
+    //project cube points onto image plane
+    vector<Point2d> front2D, back2D;
+    GeometryUtils::projectPoints(P, K, frontFace, front2D);
+    GeometryUtils::projectPoints(P, K, backFace, back2D);
     
+    //display lines
+    int t = toCanvasThickness(thickness, scale);
+    for (int i = 0; i < 4; i++) {
+        int nextPtIdx = (i+1) % 4;
+        target.drawLine(toCanvas(front2D[i], scale), toCanvas(front2D[nextPtIdx], scale), colour, t, CV_AA);
+        target.drawLine(toCanvas(back2D[i], scale), toCanvas(back2D[nextPtIdx], scale), colour, t, CV_AA);
+        target.drawLine(toCanvas(front2D[i], scale), toCanvas(back2D[i], scale), colour, t, CV_AA);
     }
-    //scale down
-    Mat dShow_small;
-    resize(dShow, dShow_small, Size(round(scale*dShow.cols), round(scale*dShow.rows)));
-    
-    return dShow_small;
 }
 
-Mat Display2D::drawRotatedRectangle(const Mat &img, const RotatedRect &rect, int thickness, Scalar colour, float scale) {
-    //set input
-    Mat dShow;
-    if (img.channels() == 3)
-        dShow = img.clone();
-    else
-        cvtColor(img,dShow,CV_GRAY2BGR);
+template <typename Target>
+static void renderRotatedRectangleTo(Target &target, const RotatedRect &rect, double scale, int thickness, const Scalar &colour) {
     
-    Point2f vtx[4], center;
+    Point2f vtx[4];
     rect.points(vtx);
-    center = rect.center;
-    for (int i = 0; i < 4; i++) {
-        line(dShow, vtx[i], vtx[(i+1)%4], colour, thickness, LINE_AA);
-    }
-    circle(dShow, center, thickness, colour, -1, CV_AA);
-    
-    //scale down
-    Mat dShow_small;
-    resize(dShow, dShow_small, Size(round(scale*dShow.cols), round(scale*dShow.rows)));
-    
-    return dShow_small;
+    int t = toCanvasThickness(thickness, scale);
+    for (int i = 0; i < 4; i++)
+        target.drawLine(toCanvas(vtx[i], scale), toCanvas(vtx[(i+1)%4], scale), colour, t, LINE_AA);
+    target.drawCircle(toCanvas(rect.center, scale), toCanvasRadius(thickness, scale), colour, -1, CV_AA);
+}
+
+void Display2D::renderFeatures(Mat &canvas, const vector<Point2d> &pts, float scale, int radius, Scalar colour) {
+    CanvasTarget target(canvas);
+    renderFeaturesTo(target, pts, scale, radius, colour);
+}
+
+void Display2D::renderFeatures(Mat &canvas, const vector<Point2f> &pts, float scale, int radius, Scalar colour) {
+    CanvasTarget target(canvas);
+    renderFeaturesTo(target, pts, scale, radius, colour);
+}
+
+void Display2D::renderMatches(Mat &canvas, const vector<Point2d> &pts0, const vector<Point2d> &pts1, int width0, float scale, int radius, Scalar colour) {
+    CanvasTarget target(canvas);
+    renderMatchesTo(target, pts0, pts1, (const vector<int> *)NULL, width0, scale, radius, colour);
+}
+
+void Display2D::renderMatches(Mat &canvas, const vector<Point2f> &pts0, const vector<Point2f> &pts1, int width0, float scale, int radius, Scalar colour) {
+    CanvasTarget target(canvas);
+    renderMatchesTo(target, pts0, pts1, (const vector<int> *)NULL, width0, scale, radius, colour);
+}
+
+void Display2D::renderMatches(Mat &canvas, const vector<Point2d> &pts0, const vector<Point2d> &pts1, const vector<int> &idx, int width0, float scale, int radius, Scalar colour) {
+    CanvasTarget target(canvas);
+    renderMatchesTo(target, pts0, pts1, &idx, width0, scale, radius, colour);
+}
+
+void Display2D::renderMatches(Mat &canvas, const vector<Point2f> &pts0, const vector<Point2f> &pts1, const vector<int> &idx, int width0, float scale, int radius, Scalar colour) {
+    CanvasTarget target(canvas);
+    renderMatchesTo(target, pts0, pts1, &idx, width0, scale, radius, colour);
+}
+
+void Display2D::renderProjections(Mat &canvas, const CameraModel &cam, const PointCloud3::View &pts, float scale, int radius, Scalar colour) {
+    CanvasTarget target(canvas);
+    renderProjectionsTo(target, cam, pts, scale, radius, colour);
+}
+
+void Display2D::renderEpipolarLines(Mat &view0, Mat &view1, const Matx33d &F, const vector<Point2d> &pts, int pts0or1, int nFeatures, float scale, int radius, Scalar colour) {
+    CanvasTarget target0(view0), target1(view1);
+    renderEpipolarLinesTo(target0, target1, F, pts, pts0or1, nFeatures, scale, radius, colour);
+}
+
+void Display2D::renderCubeWireframe(Mat &canvas, const Matx33d &K, const Matx34d &P, const vector<Matx31d> &frontFace, const vector<Matx31d> &backFace, float scale, int thickness, Scalar colour) {
+    CanvasTarget target(canvas);
+    renderCubeWireframeTo(target, K, P, frontFace, backFace, scale, thickness, colour);
+}
+
+void Display2D::renderRotatedRectangle(Mat &canvas, const RotatedRect &rect, float scale, int thickness, Scalar colour) {
+    CanvasTarget target(canvas);
+    renderRotatedRectangleTo(target, rect, scale, thickness, colour);
+}
+
+void Display2D::renderFeatures(DrawList &list, const vector<Point2d> &pts, float scale, int radius, Scalar colour) {
+    ListTarget target(list);
+    renderFeaturesTo(target, pts, scale, radius, colour);
+}
+
+void Display2D::renderFeatures(DrawList &list, const vector<Point2f> &pts, float scale, int radius, Scalar colour) {
+    ListTarget target(list);
+    renderFeaturesTo(target, pts, scale, radius, colour);
+}
+
+void Display2D::renderMatches(DrawList &list, const vector<Point2d> &pts0, const vector<Point2d> &pts1, int width0, float scale, int radius, Scalar colour) {
+    ListTarget target(list);
+    renderMatchesTo(target, pts0, pts1, (const vector<int> *)NULL, width0, scale, radius, colour);
+}
+
+void Display2D::renderMatches(DrawList &list, const vector<Point2f> &pts0, const vector<Point2f> &pts1, int width0, float scale, int radius, Scalar colour) {
+    ListTarget target(list);
+    renderMatchesTo(target, pts0, pts1, (const vector<int> *)NULL, width0, scale, radius, colour);
+}
+
+void Display2D::renderMatches(DrawList &list, const vector<Point2d> &pts0, const vector<Point2d> &pts1, const vector<int> &idx, int width0, float scale, int radius, Scalar colour) {
+    ListTarget target(list);
+    renderMatchesTo(target, pts0, pts1, &idx, width0, scale, radius, colour);
+}
+
+void Display2D::renderMatches(DrawList &list, const vector<Point2f> &pts0, const vector<Point2f> &pts1, const vector<int> &idx, int width0, float scale, int radius, Scalar colour) {
+    ListTarget target(list);
+    renderMatchesTo(target, pts0, pts1, &idx, width0, scale, radius, colour);
+}
+
+void Display2D::renderProjections(DrawList &list, const CameraModel &cam, const PointCloud3::View &pts, float scale, int radius, Scalar colour) {
+    ListTarget target(list);
+    renderProjectionsTo(target, cam, pts, scale, radius, colour);
+}
+
+void Display2D::renderEpipolarLines(DrawList &list, int width0, const Matx33d &F, const vector<Point2d> &pts, int pts0or1, int nFeatures, float scale, int radius, Scalar colour) {
+    int width0Canvas = round(scale*width0);
+    ListTarget target0(list, 0, width0Canvas), target1(list, width0Canvas, list.canvasSize().width - width0Canvas);
+    renderEpipolarLinesTo(target0, target1, F, pts, pts0or1, nFeatures, scale, radius, colour);
+}
+
+void Display2D::renderCubeWireframe(DrawList &list, const Matx33d &K, const Matx34d &P, const vector<Matx31d> &frontFace, const vector<Matx31d> &backFace, float scale, int thickness, Scalar colour) {
+    ListTarget target(list);
+    renderCubeWireframeTo(target, K, P, frontFace, backFace, scale, thickness, colour);
+}
+
+void Display2D::renderRotatedRectangle(DrawList &list, const RotatedRect &rect, float scale, int thickness, Scalar colour) {
+    ListTarget target(list);
+    renderRotatedRectangleTo(target, rect, scale, thickness, colour);
+}
+
+Mat Display2D::displayFeaturesOnFrame(const cv::Mat &img, const vector<Point2d> &pts, int radius, Scalar colour, float scale) {
+    Mat canvas;
+    prepareCanvas(img, canvas, scale);
+    renderFeatures(canvas, pts, scale, radius, colour);
+    return canvas;
+}
+
+Mat Display2D::displayFeaturesOnFrame(const cv::Mat &img, const vector<Point2f> &pts, int radius, Scalar colour, float scale) {
+    Mat canvas;
+    prepareCanvas(img, canvas, scale);
+    renderFeatures(canvas, pts, scale, radius, colour);
+    return canvas;
+}
+
+Mat Display2D::displayFeatureMatches(const cv::Mat &img0, const cv::Mat &img1, const vector<Point2d> &pts0, const vector<Point2d> &pts1, int radius, Scalar colour, float scale) {
+    Mat canvas, view0, view1;
+    prepareCanvas(img0, img1, canvas, view0, view1, scale);
+    renderMatches(canvas, pts0, pts1, img0.cols, scale, radius, colour);
+    return canvas;
+}
+
+Mat Display2D::displayFeatureMatches(const cv::Mat &img0, const cv::Mat &img1, const vector<Point2f> &pts0, const vector<Point2f> &pts1, int radius, Scalar colour, float scale) {
+    Mat canvas, view0, view1;
+    prepareCanvas(img0, img1, canvas, view0, view1, scale);
+    renderMatches(canvas, pts0, pts1, img0.cols, scale, radius, colour);
+    return canvas;
+}
+
+Mat Display2D::display3DProjections(const cv::Mat &img, const Matx33d &K, const Matx33d &R, const Matx31d &t, const vector<Matx31d> &pts, int radius, Scalar colour, float scale) {
+    return display3DProjections(img, CameraModel(K, R, t), PointCloud3::View(pts), radius, colour, scale);
+}
+
+Mat Display2D::display3DProjections(const cv::Mat &img, const CameraModel &cam, const PointCloud3::View &pts, int radius, Scalar colour, float scale) {
+    Mat canvas;
+    prepareCanvas(img, canvas, scale);
+    renderProjections(canvas, cam, pts, scale, radius, colour);
+    return canvas;
+}
+
+Mat Display2D::displayEpipolarLines(const cv::Mat &img0, const cv::Mat &img1, const Matx33d &F, const vector<Point2d> pts, int pts0or1, int nFeatures, int radius, Scalar colour, float scale) {
+    Mat canvas, view0, view1;
+    prepareCanvas(img0, img1, canvas, view0, view1, scale);
+    renderEpipolarLines(view0, view1, F, pts, pts0or1, nFeatures, scale, radius, colour);
+    return canvas;
+}
+
+Mat Display2D::drawCubeWireframe(const Mat &img, const Matx33d &K, const Matx34d &P, const vector<Matx31d> &frontFace, const vector<Matx31d> &backFace, int thickness, Scalar colour, float scale) {
+    Mat canvas;
+    prepareCanvas(img, canvas, scale);
+    renderCubeWireframe(canvas, K, P, frontFace, backFace, scale, thickness, colour);
+    return canvas;
+}
+
+Mat Display2D::drawRotatedRectangle(const Mat &img, const RotatedRect &rect, int thickness, Scalar colour, float scale) {
+    Mat canvas;
+    prepareCanvas(img, canvas, scale);
+    renderRotatedRectangle(canvas, rect, scale, thickness, colour);
+    return canvas;
 }
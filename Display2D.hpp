@@ -25,6 +25,7 @@
 
 #include <stdio.h>
 #include "GeometryUtils.hpp"
+#include "DrawList.hpp"
 
 
 using namespace std;
@@ -45,11 +46,53 @@ public:
     
     static Mat display3DProjections(const Mat &img, const Matx33d &K, const Matx33d &R, const Matx31d &t, const vector<Matx31d> &pts, int radius = 3, Scalar colour = Scalar(255,0,0), float scale = 0.5);
     
+    static Mat display3DProjections(const Mat &img, const CameraModel &cam, const PointCloud3::View &pts, int radius = 3, Scalar colour = Scalar(255,0,0), float scale = 0.5);
+    
     static Mat displayEpipolarLines(const cv::Mat &img0, const cv::Mat &img1, const Matx33d &F, const vector<Point2d> pts, int pts0or1, int nFeatures = 10, int radius = 3, Scalar colour = Scalar(255,0,0), float scale = 0.5);
     
     static Mat drawCubeWireframe(const Mat &img, const Matx33d &K, const Matx34d &P, const vector<Matx31d> &frontFace, const vector<Matx31d> &backFace, int thickness = 1, Scalar colour = Scalar(255,255,255), float scale = 0.5);
 
     static Mat drawRotatedRectangle(const Mat &img, const RotatedRect &rect, int thickness = 1, Scalar colour = Scalar(255,255,255), float scale = 0.5);
+    
+    //Layered rendering: prepareCanvas downscales (and converts to BGR) the frame once into a caller-owned canvas, reusing its memory
+    //when the size matches, then any number of render* calls draw on it directly at the canvas scale. Coordinates are given at the
+    //full input resolution and drawn with subpixel precision; radii and thicknesses are scaled too. The display* functions above
+    //are prepareCanvas followed by one render* call
+    static void prepareCanvas(const Mat &img, Mat &canvas, float scale = 0.5);
+    //side by side canvas of two frames, view0 and view1 being the regions of canvas showing img0 and img1
+    static void prepareCanvas(const Mat &img0, const Mat &img1, Mat &canvas, Mat &view0, Mat &view1, float scale = 0.5);
+    
+    //subsampling of nMatches matches: every step-th one, or the topK with the lowest residuals (all if topK <= 0), in input order
+    static void selectMatches(size_t nMatches, int step, vector<int> &idx);
+    static void selectMatches(const vector<double> &residuals, int topK, vector<int> &idx);
+    
+    static void renderFeatures(Mat &canvas, const vector<Point2d> &pts, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    static void renderFeatures(Mat &canvas, const vector<Point2f> &pts, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    //matches on a side by side canvas, width0 being the full resolution width of the first frame
+    static void renderMatches(Mat &canvas, const vector<Point2d> &pts0, const vector<Point2d> &pts1, int width0, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    static void renderMatches(Mat &canvas, const vector<Point2f> &pts0, const vector<Point2f> &pts1, int width0, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    //matches idx only, to bound the cost of drawing large match sets (see selectMatches)
+    static void renderMatches(Mat &canvas, const vector<Point2d> &pts0, const vector<Point2d> &pts1, const vector<int> &idx, int width0, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    static void renderMatches(Mat &canvas, const vector<Point2f> &pts0, const vector<Point2f> &pts1, const vector<int> &idx, int width0, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    static void renderProjections(Mat &canvas, const CameraModel &cam, const PointCloud3::View &pts, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    //features on the view of frame pts0or1, their epipolar lines on the other view
+    static void renderEpipolarLines(Mat &view0, Mat &view1, const Matx33d &F, const vector<Point2d> &pts, int pts0or1, int nFeatures = 10, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    static void renderCubeWireframe(Mat &canvas, const Matx33d &K, const Matx34d &P, const vector<Matx31d> &frontFace, const vector<Matx31d> &backFace, float scale = 0.5, int thickness = 1, Scalar colour = Scalar(255,255,255));
+    static void renderRotatedRectangle(Mat &canvas, const RotatedRect &rect, float scale = 0.5, int thickness = 1, Scalar colour = Scalar(255,255,255));
+    
+    //The render* functions again, recording into a draw list of the canvas size instead of drawing, for a single rasterization pass
+    //over any number of overlays (DrawList::rasterize). The epipolar lines are on a side by side canvas, width0 being the full
+    //resolution width of the first frame
+    static void renderFeatures(DrawList &list, const vector<Point2d> &pts, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    static void renderFeatures(DrawList &list, const vector<Point2f> &pts, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    static void renderMatches(DrawList &list, const vector<Point2d> &pts0, const vector<Point2d> &pts1, int width0, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    static void renderMatches(DrawList &list, const vector<Point2f> &pts0, const vector<Point2f> &pts1, int width0, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    static void renderMatches(DrawList &list, const vector<Point2d> &pts0, const vector<Point2d> &pts1, const vector<int> &idx, int width0, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    static void renderMatches(DrawList &list, const vector<Point2f> &pts0, const vector<Point2f> &pts1, const vector<int> &idx, int width0, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    static void renderProjections(DrawList &list, const CameraModel &cam, const PointCloud3::View &pts, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    static void renderEpipolarLines(DrawList &list, int width0, const Matx33d &F, const vector<Point2d> &pts, int pts0or1, int nFeatures = 10, float scale = 0.5, int radius = 3, Scalar colour = Scalar(255,0,0));
+    static void renderCubeWireframe(DrawList &list, const Matx33d &K, const Matx34d &P, const vector<Matx31d> &frontFace, const vector<Matx31d> &backFace, float scale = 0.5, int thickness = 1, Scalar colour = Scalar(255,255,255));
+    static void renderRotatedRectangle(DrawList &list, const RotatedRect &rect, float scale = 0.5, int thickness = 1, Scalar colour = Scalar(255,255,255));
 };
 
 #endif /* Display2D_hpp */
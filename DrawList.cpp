@@ -0,0 +1,207 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#include "DrawList.hpp"
+#include "ParallelUtils.hpp"
+
+
+DrawList::DrawList(Size canvasSize, int spriteRadius) : canvasSz(canvasSize), spriteRadius(max(0, spriteRadius)) {
+    sprites.resize((this->spriteRadius << shift) + 1);
+}
+
+void DrawList::reset(Size canvasSize) {
+    canvasSz = canvasSize;
+    commands.clear();
+}
+
+void DrawList::addCircle(const Point &centre, int radius, const Scalar &colour, int thickness, int lineType) {
+    
+    Command cmd;
+    cmd.p0 = centre;
+    cmd.p1 = centre;
+    cmd.radius = max(0, radius);
+    cmd.thickness = thickness;
+    cmd.lineType = lineType;
+    for (int i = 0; i < 4; i++)
+        cmd.colour[i] = saturate_cast<uchar>(colour[i]);
+    
+    cmd.type = CIRCLE;
+    if ((thickness < 0) && (cmd.radius < (int)sprites.size())) {
+        cmd.type = SPRITE;
+        
+        //spans of the pixels within radius of an integer centre
+        vector<int> &spans = sprites[cmd.radius];
+        if (spans.empty()) {
+            double r = cmd.radius/(double)(1 << shift);
+            for (int dy = 0; dy <= (int)r; dy++)
+                spans.push_back((int)sqrt(r*r - dy*dy));
+        }
+    }
+    commands.push_back(cmd);
+}
+
+void DrawList::addLine(const Point &p0, const Point &p1, const Scalar &colour, int thickness, int lineType) {
+    
+    Command cmd;
+    cmd.p0 = p0;
+    cmd.p1 = p1;
+    cmd.radius = 0;
+    cmd.thickness = max(1, thickness);
+    cmd.type = LINE;
+    cmd.lineType = lineType;
+    for (int i = 0; i < 4; i++)
+        cmd.colour[i] = saturate_cast<uchar>(colour[i]);
+    commands.push_back(cmd);
+}
+
+bool DrawList::tileRange(const Command &cmd, int &tx0, int &ty0, int &tx1, int &ty1) const {
+    
+    //pixel bounding box, padded by the radius, the thickness and the antialiasing
+    int pad = (cmd.radius >> shift) + max(0, (int)cmd.thickness) + 2;
+    int x0 = (min(cmd.p0.x, cmd.p1.x) >> shift) - pad, x1 = (max(cmd.p0.x, cmd.p1.x) >> shift) + pad;
+    int y0 = (min(cmd.p0.y, cmd.p1.y) >> shift) - pad, y1 = (max(cmd.p0.y, cmd.p1.y) >> shift) + pad;
+    if ((x1 < 0) || (y1 < 0) || (x0 >= canvasSz.width) || (y0 >= canvasSz.height))
+        return false;
+    
+    tx0 = max(0, x0)/tileSize;
+    ty0 = max(0, y0)/tileSize;
+    tx1 = min(canvasSz.width - 1, x1)/tileSize;
+    ty1 = min(canvasSz.height - 1, y1)/tileSize;
+    return true;
+}
+
+bool DrawList::lineTileSpan(const Command &cmd, int ty, int &tx0, int &tx1) const {
+    
+    //part of the segment within the padded band of rows of tile row ty, in fixed point
+    double pad = (max(0, (int)cmd.thickness) + 2) << shift;
+    double yBegin = ((ty*tileSize) << shift) - pad, yEnd = (((ty + 1)*tileSize) << shift) + pad;
+    double x0 = cmd.p0.x, y0 = cmd.p0.y, dx = cmd.p1.x - x0, dy = cmd.p1.y - y0;
+    double tBegin = 0, tEnd = 1;
+    if (dy != 0) {
+        double ta = (yBegin - y0)/dy, tb = (yEnd - y0)/dy;
+        tBegin = max(tBegin, min(ta, tb));
+        tEnd = min(tEnd, max(ta, tb));
+        if (tBegin > tEnd)
+            return false;
+    }
+    else if ((y0 < yBegin) || (y0 > yEnd))
+        return false;
+    
+    //tiles of its padded horizontal extent, within the bounding box range
+    double xa = x0 + tBegin*dx, xb = x0 + tEnd*dx;
+    int px0 = (int)floor((min(xa, xb) - pad)/(1 << shift)), px1 = (int)floor((max(xa, xb) + pad)/(1 << shift));
+    if ((px1 < 0) || (px0 >= canvasSz.width))
+        return false;
+    tx0 = max(tx0, max(0, px0)/tileSize);
+    tx1 = min(tx1, min(canvasSz.width - 1, px1)/tileSize);
+    return tx0 <= tx1;
+}
+
+void DrawList::sortByTile() {
+    
+    //counting sort of the (tile, command) pairs, stable so tiles keep the recording order. Lines only go to the tiles they cross
+    int tilesX = (canvasSz.width + tileSize - 1)/tileSize, tilesY = (canvasSz.height + tileSize - 1)/tileSize;
+    tileStart.assign(tilesX*tilesY + 1, 0);
+    int tx0, ty0, tx1, ty1;
+    for (size_t i = 0; i < commands.size(); i++) {
+        if (!tileRange(commands[i], tx0, ty0, tx1, ty1))
+            continue;
+        for (int ty = ty0; ty <= ty1; ty++) {
+            int rx0 = tx0, rx1 = tx1;
+            if ((commands[i].type == LINE) && (tx0 < tx1) && !lineTileSpan(commands[i], ty, rx0, rx1))
+                continue;
+            for (int tx = rx0; tx <= rx1; tx++)
+                tileStart[ty*tilesX + tx + 1]++;
+        }
+    }
+    for (size_t i = 1; i < tileStart.size(); i++)
+        tileStart[i] += tileStart[i-1];
+    
+    //filling advances each start to the next tile's, shifted back afterwards
+    tileCommands.resize(tileStart.back());
+    for (size_t i = 0; i < commands.size(); i++) {
+        if (!tileRange(commands[i], tx0, ty0, tx1, ty1))
+            continue;
+        for (int ty = ty0; ty <= ty1; ty++) {
+            int rx0 = tx0, rx1 = tx1;
+            if ((commands[i].type == LINE) && (tx0 < tx1) && !lineTileSpan(commands[i], ty, rx0, rx1))
+                continue;
+            for (int tx = rx0; tx <= rx1; tx++)
+                tileCommands[tileStart[ty*tilesX + tx]++] = (int)i;
+        }
+    }
+    for (int i = (int)tileStart.size() - 1; i > 0; i--)
+        tileStart[i] = tileStart[i-1];
+    tileStart[0] = 0;
+}
+
+void DrawList::rasterizeTile(Mat &canvas, int tile) const {
+    
+    int tilesX = (canvasSz.width + tileSize - 1)/tileSize;
+    int x = (tile % tilesX)*tileSize, y = (tile/tilesX)*tileSize;
+    Rect rect(x, y, min(tileSize, canvasSz.width - x), min(tileSize, canvasSz.height - y));
+    Mat view = canvas(rect);
+    Point offset(rect.x << shift, rect.y << shift);
+    
+    for (int k = tileStart[tile]; k < tileStart[tile+1]; k++) {
+        const Command &cmd = commands[tileCommands[k]];
+        if (cmd.type == SPRITE) {
+            
+            //stamp the spans around the nearest pixel, clipped to the tile
+            const vector<int> &spans = sprites[cmd.radius];
+            int cx = (cmd.p0.x + (1 << (shift-1))) >> shift, cy = (cmd.p0.y + (1 << (shift-1))) >> shift;
+            int h = (int)spans.size() - 1;
+            for (int y = max(cy - h, rect.y); y <= min(cy + h, rect.y + rect.height - 1); y++) {
+                int w = spans[abs(y - cy)];
+                int xBegin = max(cx - w, rect.x), xEnd = min(cx + w, rect.x + rect.width - 1);
+                uchar *px = canvas.ptr<uchar>(y) + 3*xBegin;
+                for (int x = xBegin; x <= xEnd; x++, px += 3) {
+                    px[0] = cmd.colour[0];
+                    px[1] = cmd.colour[1];
+                    px[2] = cmd.colour[2];
+                }
+            }
+        }
+        else if (cmd.type == CIRCLE)
+            circle(view, cmd.p0 - offset, cmd.radius, Scalar(cmd.colour[0], cmd.colour[1], cmd.colour[2]), cmd.thickness, cmd.lineType, shift);
+        else
+            line(view, cmd.p0 - offset, cmd.p1 - offset, Scalar(cmd.colour[0], cmd.colour[1], cmd.colour[2]), cmd.thickness, cmd.lineType, shift);
+    }
+}
+
+bool DrawList::rasterize(Mat &canvas, int nThreads) {
+    
+    if ((canvas.type() != CV_8UC3) || (canvas.size() != canvasSz)) {
+        cerr << "DrawList::rasterize: expected a CV_8UC3 canvas of " << canvasSz.width << "x" << canvasSz.height << endl;
+        return false;
+    }
+    
+    sortByTile();
+    
+    //one chunk per row of tiles
+    int tilesX = (canvasSz.width + tileSize - 1)/tileSize, tilesY = (canvasSz.height + tileSize - 1)/tileSize;
+    ParallelUtils::parallelFor(tilesX*tilesY, tilesX, nThreads, [&](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; tile++)
+            rasterizeTile(canvas, tile);
+    });
+    return true;
+}
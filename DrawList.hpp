@@ -0,0 +1,91 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef DrawList_hpp
+#define DrawList_hpp
+
+#include <stdio.h>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+//Deferred draw commands for a BGR canvas. Circles and lines are recorded in fixed point canvas coordinates and rasterized later in
+//a single pass over the canvas tiles, so that every tile is drawn while it is in cache and tiles can be drawn on several threads
+class DrawList {
+    
+public:
+    
+    //fractional bits of the recorded coordinates and radii, as the shift argument of the OpenCV drawing functions
+    static const int shift = 4;
+    
+    //side of the square tiles the canvas is rasterized in
+    static const int tileSize = 64;
+    
+    //filled circles of radius up to spriteRadius pixels are stamped from precomputed spans, without antialiasing
+    DrawList(Size canvasSize = Size(0,0), int spriteRadius = 4);
+    
+    //empties the list for a canvas of canvasSize, keeping its memory
+    void reset(Size canvasSize);
+    
+    Size canvasSize() const { return canvasSz; }
+    size_t count() const { return commands.size(); }
+    
+    void addCircle(const Point &centre, int radius, const Scalar &colour, int thickness = -1, int lineType = LINE_AA);
+    void addLine(const Point &p0, const Point &p1, const Scalar &colour, int thickness = 1, int lineType = LINE_AA);
+    
+    //draws the commands on canvas (CV_8UC3 of canvasSize()) tile by tile, in recording order within each tile. Rows of tiles are
+    //split across nThreads. Returns false if the canvas does not match
+    bool rasterize(Mat &canvas, int nThreads = 1);
+    
+private:
+    
+    enum CommandType { CIRCLE, LINE, SPRITE };
+    
+    struct Command {
+        Point p0, p1;               //centre and unused for circles
+        int radius;
+        short thickness;
+        uchar type, lineType;
+        uchar colour[4];
+    };
+    
+    Size canvasSz;
+    int spriteRadius;
+    vector<Command> commands;
+    
+    //half widths of the rows of the stamped circle of each fixed point radius, empty until used
+    vector<vector<int> > sprites;
+    
+    //commands of tile i are tileCommands[tileStart[i]] to tileCommands[tileStart[i+1]-1], in recording order
+    vector<int> tileStart, tileCommands;
+    
+    //range of tiles covered by cmd, false if it is outside the canvas
+    bool tileRange(const Command &cmd, int &tx0, int &ty0, int &tx1, int &ty1) const;
+    
+    //narrows [tx0, tx1] to the tiles of tile row ty that line cmd crosses (padded by its thickness), false if none
+    bool lineTileSpan(const Command &cmd, int ty, int &tx0, int &tx1) const;
+    void sortByTile();
+    void rasterizeTile(Mat &canvas, int tile) const;
+};
+
+#endif /* DrawList_hpp */
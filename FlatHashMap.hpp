@@ -0,0 +1,302 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef FlatHashMap_hpp
+#define FlatHashMap_hpp
+
+#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "Hashing.h"
+
+using namespace std;
+
+//Open addressing hash map with Robin Hood probing and backward shift deletion, for track tables keyed by tuples. Entries live in one
+//flat array (no allocation per entry) next to a byte array of probe distances, so lookups scan contiguous memory and stop as soon as
+//they pass the distance the key would have. The capacity is a power of two indexed with the low bits of the hash, so the hash must mix
+//all of its bits (TupleHash does). The table doubles when a probe distance would exceed 255, unless it is already less than 1/8 full:
+//then the hash is degenerate and insert throws length_error, dropping the entries that did not fit. Keys and values must be default
+//constructible; pointers to values are invalidated by insertions that grow the table and by erasures. Iterators give read only
+//access to the entries, so that keys cannot be changed in place, and mutable access to values through value()
+template <typename K, typename V, typename Hash = TupleHash<>, typename Equal = equal_to<K> >
+class FlatHashMap {
+    
+public:
+    
+    typedef pair<K, V> value_type;
+    
+    template <typename Map, typename Mapped>
+    class Iterator {
+    public:
+        Iterator(Map *map, size_t slot) : map(map), slot(slot) { skip(); }
+        const value_type &operator*() const { return map->slots[slot]; }
+        const value_type *operator->() const { return &map->slots[slot]; }
+        const K &key() const { return map->slots[slot].first; }
+        Mapped &value() const { return map->slots[slot].second; }
+        Iterator &operator++() { slot++; skip(); return *this; }
+        bool operator==(const Iterator &o) const { return slot == o.slot; }
+        bool operator!=(const Iterator &o) const { return slot != o.slot; }
+    private:
+        Map *map;
+        size_t slot;
+        void skip() { while ((slot < map->dist.size()) && (map->dist[slot] == 0)) slot++; }
+    };
+    typedef Iterator<FlatHashMap, V> iterator;
+    typedef Iterator<const FlatHashMap, const V> const_iterator;
+    
+    explicit FlatHashMap(size_t n = 0) : nEntries(0) { reserve(n); }
+    
+    size_t size() const { return nEntries; }
+    bool empty() const { return nEntries == 0; }
+    
+    //number of slots, a power of two
+    size_t capacity() const { return slots.size(); }
+    
+    //makes room for n entries without growing
+    void reserve(size_t n);
+    void clear();
+    
+    //inserts (key, value) if key is absent. Returns the value stored for key and whether it was inserted
+    pair<V *, bool> insert(const K &key, const V &value);
+    
+    //inserts the pairs of [first, last) after reserving room for all of them
+    template <typename InputIterator>
+    void insert(InputIterator first, InputIterator last);
+    
+    V &operator[](const K &key) { return *insert(key, V()).first; }
+    
+    //value stored for key or NULL
+    V *find(const K &key) { return const_cast<V *>(static_cast<const FlatHashMap *>(this)->find(key)); }
+    const V *find(const K &key) const;
+    size_t count(const K &key) const { return find(key) != NULL; }
+    
+    bool erase(const K &key);
+    
+    //erases every keys[i] with status[i] == 0, the entries rejected by a GeometryUtils filter. Returns the number erased
+    size_t erase_rejected(const vector<K> &keys, const vector<uint8_t> &status);
+    
+    //erases the entries for which pred(key, value) is true, returns the number erased
+    template <typename Predicate>
+    size_t erase_if(Predicate pred);
+    
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, slots.size()); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, slots.size()); }
+    
+private:
+    
+    //the table grows beyond 7/8 occupancy, or when a probe distance would not fit in a byte while it is at least 1/8 full
+    enum { maxLoadNum = 7, maxLoadDen = 8, minGrowLoadDen = 8, minCapacity = 8, maxDistance = 255 };
+    
+    vector<value_type> slots;
+    vector<uint8_t> dist;           //1 + distance of the entry from its home slot, 0 for empty slots
+    size_t nEntries;
+    Hash hasher;
+    Equal equal;
+    
+    size_t home(const K &key) const { return hasher(key) & (slots.size() - 1); }
+    
+    //slot holding key or -1
+    long slotOf(const K &key) const;
+    void rehash(size_t capacity);
+    
+    //Robin Hood placement of an entry known to be absent, returns its slot. Returns -1 if a probe distance overflowed, leaving the
+    //entry that could not be placed in entry
+    long place(value_type &entry);
+    
+    //doubles the capacity until entry fits, throws length_error once the table is too sparse for doubling to help
+    void grow(value_type &entry);
+};
+
+template <typename K, typename V, typename Hash, typename Equal>
+void FlatHashMap<K, V, Hash, Equal>::reserve(size_t n) {
+    size_t capacity = max(slots.size(), (size_t)minCapacity);
+    while (capacity*maxLoadNum < n*maxLoadDen)
+        capacity *= 2;
+    if (capacity != slots.size())
+        rehash(capacity);
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+void FlatHashMap<K, V, Hash, Equal>::clear() {
+    for (size_t i = 0; i < slots.size(); i++) {
+        if (dist[i]) {
+            slots[i] = value_type();
+            dist[i] = 0;
+        }
+    }
+    nEntries = 0;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+void FlatHashMap<K, V, Hash, Equal>::rehash(size_t capacity) {
+    
+    vector<value_type> oldSlots(capacity);
+    vector<uint8_t> oldDist(capacity, 0);
+    oldSlots.swap(slots);
+    oldDist.swap(dist);
+    vector<value_type> leftover;
+    for (size_t i = 0; i < oldSlots.size(); i++) {
+        if (oldDist[i]) {
+            value_type entry(std::move(oldSlots[i]));
+            if (place(entry) < 0)
+                leftover.push_back(std::move(entry));
+        }
+    }
+    for (size_t i = 0; i < leftover.size(); i++)
+        grow(leftover[i]);
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+void FlatHashMap<K, V, Hash, Equal>::grow(value_type &entry) {
+    do {
+        //long probes in a sparse table come from keys sharing the low bits of their hash, which doubling does not separate
+        if (nEntries*minGrowLoadDen < slots.size()) {
+            nEntries = slots.size() - std::count(dist.begin(), dist.end(), 0);
+            throw length_error("FlatHashMap: more than 255 keys probe from the same slot, the hash does not mix its low bits");
+        }
+        rehash(slots.size()*2);
+    } while (place(entry) < 0);
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+long FlatHashMap<K, V, Hash, Equal>::place(value_type &entry) {
+    
+    size_t mask = slots.size() - 1, i = home(entry.first);
+    long placed = -1;
+    for (int d = 1; d <= maxDistance; d++, i = (i + 1) & mask) {
+        if (dist[i] == 0) {
+            slots[i] = std::move(entry);
+            dist[i] = d;
+            return (placed < 0) ? (long)i : placed;
+        }
+        
+        //take the slot of richer entries and carry them on
+        if (dist[i] < d) {
+            swap(entry, slots[i]);
+            int displaced = dist[i];
+            dist[i] = d;
+            d = displaced;
+            if (placed < 0)
+                placed = i;
+        }
+    }
+    return -1;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+long FlatHashMap<K, V, Hash, Equal>::slotOf(const K &key) const {
+    
+    if (nEntries == 0)
+        return -1;
+    
+    //entries of a cluster are ordered by distance, so stop once they are closer to home than key would be
+    size_t mask = slots.size() - 1, i = home(key);
+    for (int d = 1; dist[i] >= d; d++, i = (i + 1) & mask) {
+        if ((dist[i] == d) && equal(slots[i].first, key))
+            return i;
+    }
+    return -1;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+const V *FlatHashMap<K, V, Hash, Equal>::find(const K &key) const {
+    long slot = slotOf(key);
+    return (slot < 0) ? NULL : &slots[slot].second;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+pair<V *, bool> FlatHashMap<K, V, Hash, Equal>::insert(const K &key, const V &value) {
+    
+    V *found = find(key);
+    if (found != NULL)
+        return make_pair(found, false);
+    
+    if ((nEntries + 1)*maxLoadDen > slots.size()*maxLoadNum)
+        reserve(nEntries + 1);
+    value_type entry(key, value);
+    long slot = place(entry);
+    nEntries++;
+    if (slot < 0) {
+        grow(entry);
+        slot = slotOf(key);
+    }
+    return make_pair(&slots[slot].second, true);
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+template <typename InputIterator>
+void FlatHashMap<K, V, Hash, Equal>::insert(InputIterator first, InputIterator last) {
+    reserve(nEntries + distance(first, last));
+    for (; first != last; ++first)
+        insert(first->first, first->second);
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+bool FlatHashMap<K, V, Hash, Equal>::erase(const K &key) {
+    
+    long slot = slotOf(key);
+    if (slot < 0)
+        return false;
+    
+    //shift the following entries of the cluster back by one slot
+    size_t mask = slots.size() - 1, i = slot;
+    for (size_t j = (i + 1) & mask; dist[j] > 1; i = j, j = (j + 1) & mask) {
+        slots[i] = std::move(slots[j]);
+        dist[i] = dist[j] - 1;
+    }
+    slots[i] = value_type();
+    dist[i] = 0;
+    nEntries--;
+    return true;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+size_t FlatHashMap<K, V, Hash, Equal>::erase_rejected(const vector<K> &keys, const vector<uint8_t> &status) {
+    size_t erased = 0;
+    for (size_t i = 0; i < keys.size(); i++)
+        if (!status[i])
+            erased += erase(keys[i]);
+    return erased;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+template <typename Predicate>
+size_t FlatHashMap<K, V, Hash, Equal>::erase_if(Predicate pred) {
+    
+    //erasing shifts entries, so collect the keys first
+    vector<K> doomed;
+    for (size_t i = 0; i < slots.size(); i++)
+        if (dist[i] && pred(slots[i].first, slots[i].second))
+            doomed.push_back(slots[i].first);
+    for (size_t i = 0; i < doomed.size(); i++)
+        erase(doomed[i]);
+    return doomed.size();
+}
+
+#endif /* FlatHashMap_hpp */
@@ -0,0 +1,263 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#include "FrameRecorder.hpp"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static const char kRawMagic[8] = "CVURAW1";
+
+FrameRecorder::FrameRecorder() : format(MJPEG), fps(30), maxMemory(0), ringFrames(0), recording(false), outputOpen(false), outputFailed(false), frameType(-1), fd(-1), map(NULL), mapBytes(0), queuedBytes(0), stopping(false), written(0), dropped(0) {
+}
+
+FrameRecorder::~FrameRecorder() {
+    close();
+}
+
+bool FrameRecorder::open(const string &path, Format format, double fps, size_t maxMemory, int ringFrames) {
+    
+    close();
+    if ((fps <= 0) || ((format == RAW) && (ringFrames <= 0))) {
+        cerr << "FrameRecorder: invalid frame rate or ring size" << endl;
+        return false;
+    }
+    
+    this->path = path;
+    this->format = format;
+    this->fps = fps;
+    this->maxMemory = maxMemory;
+    this->ringFrames = ringFrames;
+    written = 0;
+    dropped = 0;
+    stopping = false;
+    outputFailed = false;
+    recording = true;
+    worker = thread(&FrameRecorder::run, this);
+    return true;
+}
+
+bool FrameRecorder::openOutput(const Mat &frame) {
+    
+    frameSize = frame.size();
+    frameType = frame.type();
+    if (format == MJPEG) {
+        if ((frame.depth() != CV_8U) || ((frame.channels() != 1) && (frame.channels() != 3))) {
+            cerr << "FrameRecorder: MJPEG needs 8-bit grey or BGR frames" << endl;
+            return false;
+        }
+        if (!video.open(path, VideoWriter::fourcc('M','J','P','G'), fps, frameSize, frame.channels() == 3)) {
+            cerr << "FrameRecorder: could not open " << path << endl;
+            return false;
+        }
+        return true;
+    }
+    
+    //size the file for the whole ring and map it
+    size_t frameBytes = frame.total()*frame.elemSize();
+    mapBytes = sizeof(RawHeader) + frameBytes*ringFrames;
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if ((fd < 0) || (ftruncate(fd, mapBytes) != 0)) {
+        cerr << "FrameRecorder: could not create " << path << endl;
+        closeOutput();
+        return false;
+    }
+    void *addr = mmap(NULL, mapBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        cerr << "FrameRecorder: could not map " << path << endl;
+        closeOutput();
+        return false;
+    }
+    map = (uchar *)addr;
+    
+    RawHeader *header = (RawHeader *)map;
+    memcpy(header->magic, kRawMagic, sizeof(kRawMagic));
+    header->width = frameSize.width;
+    header->height = frameSize.height;
+    header->type = frameType;
+    header->reserved = 0;
+    header->frameBytes = frameBytes;
+    header->capacity = ringFrames;
+    header->count = 0;
+    header->fps = fps;
+    return true;
+}
+
+void FrameRecorder::closeOutput() {
+    
+    if (video.isOpened())
+        video.release();
+    if (map != NULL) {
+        msync(map, mapBytes, MS_SYNC);
+        munmap(map, mapBytes);
+        map = NULL;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    outputOpen = false;
+}
+
+bool FrameRecorder::write(const Mat &frame) {
+    
+    if (!recording || frame.empty())
+        return false;
+    
+    //the first frame opens the file, which is not retried until the next open if it fails
+    if (outputFailed) {
+        dropped++;
+        return false;
+    }
+    if (!outputOpen) {
+        if (!openOutput(frame)) {
+            closeOutput();
+            outputFailed = true;
+            dropped++;
+            return false;
+        }
+        outputOpen = true;
+    }
+    if ((frame.size() != frameSize) || (frame.type() != frameType)) {
+        cerr << "FrameRecorder: frame size or type differs from the first frame" << endl;
+        dropped++;
+        return false;
+    }
+    
+    //reserve memory and a buffer, then copy outside the lock
+    size_t bytes = frame.total()*frame.elemSize();
+    Mat buffer;
+    {
+        unique_lock<mutex> guard(lock);
+        if (queuedBytes + bytes > maxMemory) {
+            dropped++;
+            return false;
+        }
+        queuedBytes += bytes;
+        if (!pool.empty()) {
+            buffer = pool.back();
+            pool.pop_back();
+        }
+    }
+    frame.copyTo(buffer);
+    {
+        unique_lock<mutex> guard(lock);
+        queue.push_back(buffer);
+    }
+    ready.notify_one();
+    return true;
+}
+
+void FrameRecorder::encode(const Mat &frame) {
+    
+    if (format == MJPEG) {
+        video.write(frame);
+        return;
+    }
+    
+    //copy into the ring slot before publishing the new count
+    RawHeader *header = (RawHeader *)map;
+    uchar *slot = map + sizeof(RawHeader) + (header->count % header->capacity)*header->frameBytes;
+    size_t rowBytes = frame.cols*frame.elemSize();
+    for (int i = 0; i < frame.rows; i++)
+        memcpy(slot + i*rowBytes, frame.ptr(i), rowBytes);
+    header->count++;
+}
+
+void FrameRecorder::run() {
+    
+    while (true) {
+        Mat frame;
+        {
+            unique_lock<mutex> guard(lock);
+            ready.wait(guard, [this]() { return stopping || !queue.empty(); });
+            if (queue.empty())
+                break;
+            frame = queue.front();
+            queue.pop_front();
+        }
+        
+        encode(frame);
+        written++;
+        
+        {
+            unique_lock<mutex> guard(lock);
+            queuedBytes -= frame.total()*frame.elemSize();
+            pool.push_back(frame);
+        }
+    }
+}
+
+void FrameRecorder::close() {
+    
+    if (!recording)
+        return;
+    
+    //the worker drains the queue before exiting
+    {
+        unique_lock<mutex> guard(lock);
+        stopping = true;
+    }
+    ready.notify_one();
+    if (worker.joinable())
+        worker.join();
+    
+    closeOutput();
+    pool.clear();
+    queuedBytes = 0;
+    recording = false;
+}
+
+bool FrameRecorder::readRaw(const string &path, vector<Mat> &frames, double *fps) {
+    
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == NULL) {
+        cerr << "FrameRecorder: could not open " << path << endl;
+        return false;
+    }
+    
+    RawHeader header;
+    if ((fread(&header, sizeof(header), 1, file) != 1) || (memcmp(header.magic, kRawMagic, sizeof(kRawMagic)) != 0)) {
+        cerr << "FrameRecorder: " << path << " is not a raw frame file" << endl;
+        fclose(file);
+        return false;
+    }
+    
+    //oldest frame still in the ring first
+    uint64 n = min(header.count, header.capacity);
+    frames.resize(n);
+    bool ok = true;
+    for (uint64 i = 0; (i < n) && ok; i++) {
+        uint64 slot = (header.count - n + i) % header.capacity;
+        frames[i].create(header.height, header.width, header.type);
+        ok = (fseek(file, sizeof(RawHeader) + slot*header.frameBytes, SEEK_SET) == 0) && (fread(frames[i].data, header.frameBytes, 1, file) == 1);
+    }
+    fclose(file);
+    if (!ok) {
+        cerr << "FrameRecorder: " << path << " is truncated" << endl;
+        return false;
+    }
+    if (fps != NULL)
+        *fps = header.fps;
+    return true;
+}
@@ -0,0 +1,108 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef FrameRecorder_hpp
+#define FrameRecorder_hpp
+
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+//Streams frames (Display2D output or a reused canvas) to a single file, encoding on a worker thread. Frames are copied into pooled
+//buffers on write, so the caller can reuse its canvas right away. The file is either an MJPEG AVI written with cv::VideoWriter or a
+//raw ring of fixed-size frames in a memory-mapped file, keeping the last ringFrames frames
+class FrameRecorder {
+    
+public:
+    
+    enum Format { MJPEG, RAW };
+    
+    //layout of a raw file: this header, then capacity frames of frameBytes bytes. Frame i (counting from 0) is in slot i % capacity
+    struct RawHeader {
+        char magic[8];              //"CVURAW1"
+        int32_t width, height, type;
+        int32_t reserved;
+        uint64 frameBytes, capacity;
+        uint64 count;               //number of frames written
+        double fps;
+    };
+    
+    FrameRecorder();
+    ~FrameRecorder();
+    
+    //Starts a recording to path at fps frames per second. The file is created on the first frame, which fixes the size and type of
+    //all frames. Frames waiting to be encoded take at most maxMemory bytes, further frames are dropped until the encoder catches up
+    bool open(const string &path, Format format, double fps = 30, size_t maxMemory = 64 << 20, int ringFrames = 300);
+    
+    //queues a copy of frame, returns false if it was dropped or does not match the first frame. If the file cannot be created, this
+    //and every later frame of the recording are dropped
+    bool write(const Mat &frame);
+    
+    //encodes the queued frames and closes the file
+    void close();
+    
+    bool isOpen() const { return recording; }
+    uint64 framesWritten() const { return written.load(); }
+    uint64 framesDropped() const { return dropped.load(); }
+    
+    //frames of a raw file, oldest first
+    static bool readRaw(const string &path, vector<Mat> &frames, double *fps = NULL);
+    
+private:
+    
+    string path;
+    Format format;
+    double fps;
+    size_t maxMemory;
+    int ringFrames;
+    bool recording, outputOpen, outputFailed;
+    Size frameSize;
+    int frameType;
+    
+    VideoWriter video;
+    int fd;
+    uchar *map;
+    size_t mapBytes;
+    
+    mutex lock;
+    condition_variable ready;
+    deque<Mat> queue;
+    vector<Mat> pool;               //buffers of encoded frames, reused by write
+    size_t queuedBytes;
+    bool stopping;
+    atomic<uint64> written, dropped;
+    thread worker;
+    
+    bool openOutput(const Mat &frame);
+    void closeOutput();
+    void encode(const Mat &frame);
+    void run();
+};
+
+#endif /* FrameRecorder_hpp */
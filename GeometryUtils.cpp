@@ -21,98 +21,436 @@
  *******************************************************************************/
 
 #include "GeometryUtils.hpp"
+#include "MathUtils.hpp"
+#include <numeric>
 
-Matx31d GeometryUtils::linearTriangulation(const Matx34d &P0, const Matx34d &P1, const Point3d pt0, const Point3d pt1, int iter) {
+//number of points solved together by the batch triangulation kernel (one AVX2 register of doubles). The normal equations square
+//the condition number, so triangulation stays in double whatever the type of the observations
+static const int kTriangulationLanes = 4;
+//number of points per work item of the parallel triangulation
+static const size_t kTriangulationChunk = 512;
+
+//adds the two rows of the linear triangulation system contributed by observation (u,v) in view P
+//to the (upper triangle of the) normal matrix G and the right hand side h
+static inline void accumulateTriangulationRows(const Matx34d &P, double u, double v, double *G, double *h) {
+    double a[4], b[4];
+    for (int k = 0; k < 4; k++) {
+        a[k] = u*P(2,k) - P(0,k);
+        b[k] = v*P(2,k) - P(1,k);
+    }
+    G[0] = a[0]*a[0] + b[0]*b[0];
+    G[1] = a[0]*a[1] + b[0]*b[1];
+    G[2] = a[0]*a[2] + b[0]*b[2];
+    G[3] = a[1]*a[1] + b[1]*b[1];
+    G[4] = a[1]*a[2] + b[1]*b[2];
+    G[5] = a[2]*a[2] + b[2]*b[2];
+    h[0] = -(a[0]*a[3] + b[0]*b[3]);
+    h[1] = -(a[1]*a[3] + b[1]*b[3]);
+    h[2] = -(a[2]*a[3] + b[2]*b[3]);
+}
+
+//solves the symmetric 3x3 system N*X = r by cofactor expansion (N given as its upper triangle)
+static inline void solveSymmetric3x3(const double *N, const double *r, double &x, double &y, double &z) {
+    double c00 = N[3]*N[5] - N[4]*N[4];
+    double c01 = N[2]*N[4] - N[1]*N[5];
+    double c02 = N[1]*N[4] - N[2]*N[3];
+    double c11 = N[0]*N[5] - N[2]*N[2];
+    double c12 = N[1]*N[2] - N[0]*N[4];
+    double c22 = N[0]*N[3] - N[1]*N[1];
+    double idet = 1.0/(N[0]*c00 + N[1]*c01 + N[2]*c02);
+    x = (c00*r[0] + c01*r[1] + c02*r[2])*idet;
+    y = (c01*r[0] + c11*r[1] + c12*r[2])*idet;
+    z = (c02*r[0] + c12*r[1] + c22*r[2])*idet;
+}
+
+//Iteratively reweighted linear triangulation of kTriangulationLanes points at once, from normalised
+//coordinates. Each lane runs the same iterations as linearTriangulation and freezes its solution as soon
+//as its own weights converge, so the result of a lane never depends on the other lanes of the block.
+static void triangulateBlock(const Matx34d &P0, const Matx34d &P1, const double *u0, const double *v0, const double *u1, const double *v1, int iter, double *X, double *Y, double *Z) {
+    
+    const int L = kTriangulationLanes;
+    const double eps = 1e-04;
+    
+    //the weights only scale the rows, so the normal equations of each view are built once
+    double G0[6][L], h0[3][L], G1[6][L], h1[3][L];
+    for (int l = 0; l < L; l++) {
+        double G[6], h[3];
+        accumulateTriangulationRows(P0, u0[l], v0[l], G, h);
+        for (int k = 0; k < 6; k++) G0[k][l] = G[k];
+        for (int k = 0; k < 3; k++) h0[k][l] = h[k];
+        accumulateTriangulationRows(P1, u1[l], v1[l], G, h);
+        for (int k = 0; k < 6; k++) G1[k][l] = G[k];
+        for (int k = 0; k < 3; k++) h1[k][l] = h[k];
+    }
     
-    //TODO: include two or three equations from each image?
-    //TODO: currently using inhomogeneous solution
-    Mat X;
-    double wi = 1, wi1 = 1, p2x = 0, p2x1 = 0;
-    double eps = 1e-04;
-    for(int i =0; i < iter; i++) {
-        
-        Matx43d A((pt0.x*P0(2,0) - P0(0,0))/wi, (pt0.x*P0(2,1) - P0(0,1))/wi, (pt0.x*P0(2,2) - P0(0,2))/wi,
-                  (pt0.y*P0(2,0) - P0(1,0))/wi, (pt0.y*P0(2,1) - P0(1,1))/wi, (pt0.y*P0(2,2) - P0(1,2))/wi,
-                  (pt1.x*P1(2,0) - P1(0,0))/wi1, (pt1.x*P1(2,1) - P1(0,1))/wi1, (pt1.x*P1(2,2) - P1(0,2))/wi1,
-                  (pt1.y*P1(2,0) - P1(1,0))/wi1, (pt1.y*P1(2,1) - P1(1,1))/wi1, (pt1.y*P1(2,2) - P1(1,2))/wi1);
-        Matx41d B(-(pt0.x*P0(2,3) - P0(0,3))/wi, -(pt0.y*P0(2,3) - P0(1,3))/wi, -(pt1.x*P1(2,3) - P1(0,3))/wi1, -(pt1.y*P1(2,3) - P1(1,3))/wi1);
-        
-        solve(A,B,X,DECOMP_SVD);
-        //cout << "Iter " << i << ": " << X << endl;
-        
-        //check if time to break
-        Matx41d xcol(X.ptr<double>(0)[0],X.ptr<double>(0)[1],X.ptr<double>(0)[2],1.0);
-        p2x = (P0.row(2)*xcol)(0);
-        p2x1 = (P1.row(2)*xcol)(0);
-        
-        if ((fabs(wi - p2x) <= eps) && (fabs(wi1 - p2x1) <= eps))
+    double wi[L], wi1[L], active[L];
+    for (int l = 0; l < L; l++) {
+        wi[l] = 1;
+        wi1[l] = 1;
+        active[l] = 1;
+        X[l] = Y[l] = Z[l] = 0;
+    }
+    
+    for (int i = 0; i < iter; i++) {
+        double nActive = 0;
+        for (int l = 0; l < L; l++) {
+            //weighted normal equations
+            double s0 = 1.0/(wi[l]*wi[l]), s1 = 1.0/(wi1[l]*wi1[l]);
+            double N[6], r[3], x, y, z;
+            for (int k = 0; k < 6; k++) N[k] = s0*G0[k][l] + s1*G1[k][l];
+            for (int k = 0; k < 3; k++) r[k] = s0*h0[k][l] + s1*h1[k][l];
+            solveSymmetric3x3(N, r, x, y, z);
+            
+            //lanes that have already converged keep their solution
+            X[l] = active[l] != 0 ? x : X[l];
+            Y[l] = active[l] != 0 ? y : Y[l];
+            Z[l] = active[l] != 0 ? z : Z[l];
+            
+            //check if time to stop and update weights
+            double p2x = P0(2,0)*x + P0(2,1)*y + P0(2,2)*z + P0(2,3);
+            double p2x1 = P1(2,0)*x + P1(2,1)*y + P1(2,2)*z + P1(2,3);
+            double converged = ((fabs(wi[l] - p2x) <= eps) && (fabs(wi1[l] - p2x1) <= eps)) ? 1 : 0;
+            active[l] *= 1 - converged;
+            wi[l] = p2x;
+            wi1[l] = p2x1;
+            nActive += active[l];
+        }
+        if (nActive == 0)
             break;
+    }
+}
+
+//Triangulates n correspondences given as strided pixel coordinates (stride in elements, so the same code
+//reads SoA arrays and Point2_ vectors) and writes them to strided outputs. Every point goes through the
+//same lane code, the tail is padded with the last point.
+template <typename T>
+static void triangulateStrided(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0i, const Matx33d &K1i, const T *x0, const T *y0, const T *x1, const T *y1, size_t inStride, size_t n, double *X, double *Y, double *Z, size_t outStride, int iter) {
+    
+    const int L = kTriangulationLanes;
+    double u0[L], v0[L], u1[L], v1[L], bx[L], by[L], bz[L];
+    for (size_t b = 0; b < n; b += L) {
+        //convert to normalised coordinates
+        for (int l = 0; l < L; l++) {
+            size_t k = min(b + l, n - 1)*inStride;
+            u0[l] = K0i(0,0)*x0[k] + K0i(0,1)*y0[k] + K0i(0,2);
+            v0[l] = K0i(1,0)*x0[k] + K0i(1,1)*y0[k] + K0i(1,2);
+            u1[l] = K1i(0,0)*x1[k] + K1i(0,1)*y1[k] + K1i(0,2);
+            v1[l] = K1i(1,0)*x1[k] + K1i(1,1)*y1[k] + K1i(1,2);
+        }
+        
+        triangulateBlock(P0, P1, u0, v0, u1, v1, iter, bx, by, bz);
         
-        //update weights
-        wi = p2x;
-        wi1 = p2x1;
+        size_t m = min((size_t)L, n - b);
+        for (size_t l = 0; l < m; l++) {
+            X[(b + l)*outStride] = bx[l];
+            Y[(b + l)*outStride] = by[l];
+            Z[(b + l)*outStride] = bz[l];
+        }
     }
-    Matx31d sol(X.ptr<double>(0)[0],X.ptr<double>(0)[1],X.ptr<double>(0)[2]);
-    return sol;
 }
 
-void GeometryUtils::triangulatePoints(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0, const Matx33d &K1, const vector<Point2d> &f0, const vector<Point2d> &f1, vector<Matx31d> &outPts) {
+//single correspondence through the lane code: every lane holds the same point
+template <typename T>
+static Matx31d linearTriangulationImpl(const Matx34d &P0, const Matx34d &P1, const Point_<T> &pt0, const Point_<T> &pt1, int iter) {
+    
+    //TODO: include two or three equations from each image?
+    //TODO: currently using inhomogeneous solution
+    const int L = kTriangulationLanes;
+    double u0[L], v0[L], u1[L], v1[L], X[L], Y[L], Z[L];
+    for (int l = 0; l < L; l++) {
+        u0[l] = pt0.x;
+        v0[l] = pt0.y;
+        u1[l] = pt1.x;
+        v1[l] = pt1.y;
+    }
+    triangulateBlock(P0, P1, u0, v0, u1, v1, iter, X, Y, Z);
+    
+    return Matx31d(X[0], Y[0], Z[0]);
+}
+
+Matx31d GeometryUtils::linearTriangulation(const Matx34d &P0, const Matx34d &P1, const Point2d &pt0, const Point2d &pt1, int iter) {
+    return linearTriangulationImpl(P0, P1, pt0, pt1, iter);
+}
+
+Matx31d GeometryUtils::linearTriangulation(const Matx34d &P0, const Matx34d &P1, const Point2f &pt0, const Point2f &pt1, int iter) {
+    return linearTriangulationImpl(P0, P1, pt0, pt1, iter);
+}
+
+template <typename T>
+static void triangulatePointsSerial(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0i, const Matx33d &K1i, const vector<Point_<T> > &f0, const vector<Point_<T> > &f1, vector<Matx31d> &outPts) {
     
     //preallocate for speed
-    outPts.reserve(f0.size());
+    size_t offset = outPts.size();
+    outPts.resize(offset + f0.size());
+    if (f0.empty())
+        return;
     
-    Matx33d K0i = K0.inv();
-    Matx33d K1i = K1.inv();
-    for (int i = 0; i < f0.size(); i++) {
-        Point3d pt0(f0[i].x,f0[i].y,1);
-        Point3d pt1(f1[i].x,f1[i].y,1);
-        //convert to normalised coordinates
-        Point3d pt0n = K0i*pt0;
-        Point3d pt1n = K1i*pt1;
-        //solve linear system
-        Matx31d X = linearTriangulation(P0, P1, pt0n, pt1n, 10);
-        outPts.push_back(X);
-    }
+    double *out = outPts[offset].val;
+    triangulateStrided(P0, P1, K0i, K1i, &f0[0].x, &f0[0].y, &f1[0].x, &f1[0].y, 2, f0.size(), out, out + 1, out + 2, 3, 10);
+}
+
+void GeometryUtils::triangulatePoints(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0, const Matx33d &K1, const vector<Point2d> &f0, const vector<Point2d> &f1, vector<Matx31d> &outPts) {
+    triangulatePointsSerial(P0, P1, K0.inv(), K1.inv(), f0, f1, outPts);
 }
 
 void GeometryUtils::triangulatePoints(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0, const Matx33d &K1, const vector<Point2f> &f0, const vector<Point2f> &f1, vector<Matx31d> &outPts) {
+    triangulatePointsSerial(P0, P1, K0.inv(), K1.inv(), f0, f1, outPts);
+}
+
+template <typename T>
+static void triangulatePointsParallel(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0i, const Matx33d &K1i, const vector<Point_<T> > &f0, const vector<Point_<T> > &f1, vector<Matx31d> &outPts, const ParallelUtils::Executor &executor) {
+    
+    //preallocate output slots so chunks can be written independently
+    size_t offset = outPts.size();
+    outPts.resize(offset + f0.size());
+    if (f0.empty())
+        return;
+    
+    double *out = outPts[offset].val;
+    ParallelUtils::parallelFor(f0.size(), kTriangulationChunk, executor, [&](size_t begin, size_t end) {
+        triangulateStrided(P0, P1, K0i, K1i, &f0[begin].x, &f0[begin].y, &f1[begin].x, &f1[begin].y, 2, end - begin, out + 3*begin, out + 3*begin + 1, out + 3*begin + 2, 3, 10);
+    }, kTriangulationLanes);
+}
+
+void GeometryUtils::triangulatePoints(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0, const Matx33d &K1, const vector<Point2d> &f0, const vector<Point2d> &f1, vector<Matx31d> &outPts, int nThreads) {
     
-    //preallocate for speed
-    outPts.reserve(f0.size());
+    if (nThreads <= 1)
+        triangulatePoints(P0, P1, K0, K1, f0, f1, outPts);
+    else
+        triangulatePointsParallel(P0, P1, K0.inv(), K1.inv(), f0, f1, outPts, ParallelUtils::threadExecutor(nThreads));
+}
+
+void GeometryUtils::triangulatePoints(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0, const Matx33d &K1, const vector<Point2f> &f0, const vector<Point2f> &f1, vector<Matx31d> &outPts, int nThreads) {
+    
+    if (nThreads <= 1)
+        triangulatePoints(P0, P1, K0, K1, f0, f1, outPts);
+    else
+        triangulatePointsParallel(P0, P1, K0.inv(), K1.inv(), f0, f1, outPts, ParallelUtils::threadExecutor(nThreads));
+}
+
+void GeometryUtils::triangulatePoints(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0, const Matx33d &K1, const vector<Point2d> &f0, const vector<Point2d> &f1, vector<Matx31d> &outPts, const ParallelUtils::Executor &executor) {
+    triangulatePointsParallel(P0, P1, K0.inv(), K1.inv(), f0, f1, outPts, executor);
+}
+
+void GeometryUtils::triangulatePoints(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0, const Matx33d &K1, const vector<Point2f> &f0, const vector<Point2f> &f1, vector<Matx31d> &outPts, const ParallelUtils::Executor &executor) {
+    triangulatePointsParallel(P0, P1, K0.inv(), K1.inv(), f0, f1, outPts, executor);
+}
+
+void GeometryUtils::triangulatePoints(const CameraModel &cam0, const CameraModel &cam1, const vector<Point2d> &f0, const vector<Point2d> &f1, vector<Matx31d> &outPts, int nThreads) {
+    
+    if (nThreads <= 1)
+        triangulatePointsSerial(cam0.getP(), cam1.getP(), cam0.getKinv(), cam1.getKinv(), f0, f1, outPts);
+    else
+        triangulatePointsParallel(cam0.getP(), cam1.getP(), cam0.getKinv(), cam1.getKinv(), f0, f1, outPts, ParallelUtils::threadExecutor(nThreads));
+}
+
+void GeometryUtils::triangulatePoints(const CameraModel &cam0, const CameraModel &cam1, const vector<Point2f> &f0, const vector<Point2f> &f1, vector<Matx31d> &outPts, int nThreads) {
+    
+    if (nThreads <= 1)
+        triangulatePointsSerial(cam0.getP(), cam1.getP(), cam0.getKinv(), cam1.getKinv(), f0, f1, outPts);
+    else
+        triangulatePointsParallel(cam0.getP(), cam1.getP(), cam0.getKinv(), cam1.getKinv(), f0, f1, outPts, ParallelUtils::threadExecutor(nThreads));
+}
+
+template <typename T>
+static void triangulatePointsCloud(const CameraModel &cam0, const CameraModel &cam1, const vector<Point_<T> > &f0, const vector<Point_<T> > &f1, PointCloud3 &outPts, int nThreads) {
+    
+    //preallocate output slots so chunks can be written independently
+    size_t offset = outPts.size();
+    outPts.resize(offset + f0.size());
+    if (f0.empty())
+        return;
+    
+    double *X = outPts.x() + offset, *Y = outPts.y() + offset, *Z = outPts.z() + offset;
+    ParallelUtils::parallelFor(f0.size(), kTriangulationChunk, nThreads, [&](size_t begin, size_t end) {
+        triangulateStrided(cam0.getP(), cam1.getP(), cam0.getKinv(), cam1.getKinv(), &f0[begin].x, &f0[begin].y, &f1[begin].x, &f1[begin].y, 2, end - begin, X + begin, Y + begin, Z + begin, 1, 10);
+    }, kTriangulationLanes);
+}
+
+void GeometryUtils::triangulatePoints(const CameraModel &cam0, const CameraModel &cam1, const vector<Point2d> &f0, const vector<Point2d> &f1, PointCloud3 &outPts, int nThreads) {
+    triangulatePointsCloud(cam0, cam1, f0, f1, outPts, nThreads);
+}
+
+void GeometryUtils::triangulatePoints(const CameraModel &cam0, const CameraModel &cam1, const vector<Point2f> &f0, const vector<Point2f> &f1, PointCloud3 &outPts, int nThreads) {
+    triangulatePointsCloud(cam0, cam1, f0, f1, outPts, nThreads);
+}
+
+void GeometryUtils::triangulatePointsBatch(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0, const Matx33d &K1, const double *x0, const double *y0, const double *x1, const double *y1, size_t n, double *X, double *Y, double *Z, int iter) {
+    
+    if (n == 0)
+        return;
     
     Matx33d K0i = K0.inv();
     Matx33d K1i = K1.inv();
-    for (int i = 0; i < f0.size(); i++) {
-        Point3d pt0(f0[i].x,f0[i].y,1);
-        Point3d pt1(f1[i].x,f1[i].y,1);
-        //convert to normalised coordinates
-        Point3d pt0n = K0i*pt0;
-        Point3d pt1n = K1i*pt1;
-        //solve linear system
-        Matx31d X = linearTriangulation(P0, P1, pt0n, pt1n, 10);
-        outPts.push_back(X);
-    }
+    triangulateStrided(P0, P1, K0i, K1i, x0, y0, x1, y1, 1, n, X, Y, Z, 1, iter);
 }
 
-void GeometryUtils::projectPoints(const Matx34d &P, const Matx33d &K, const vector<Matx31d> &pts3D, vector<Point2d> &pts2D, Size imSize) {
-    
-    Matx34d Pmat = K*P;
+//number of tracks per work item of the parallel track triangulation
+static const size_t kTrackChunk = 256;
+
+//depth of X in view P = [R|t]
+static inline double viewDepth(const Matx34d &P, double x, double y, double z) {
+    return P(2,0)*x + P(2,1)*y + P(2,2)*z + P(2,3);
+}
+
+//number of observations of a track whose rows are kept on the stack between iterations, longer tracks rebuild the rest
+static const int kTrackCachedViews = 16;
+
+//Iteratively reweighted linear triangulation of one track of m observations, the N-view form of triangulateBlock: the rows of
+//every view are scaled by the depth of the previous solution until no depth moves by more than eps. The rows and depths of the
+//first kTrackCachedViews observations are kept in fixed size stack arrays, those of longer tracks are rebuilt on every iteration
+static void triangulateTrack(const CameraModel *cams, const int *view, const Point2d *pts, int m, int iter, double &X, double &Y, double &Z) {
+    
+    const double eps = 1e-04;
+    const int C = kTrackCachedViews;
+    double G[C][6], h[C][3], w[C];
+    int nCached = min(m, C);
+    for (int k = 0; k < nCached; k++) {
+        const CameraModel &cam = cams[view[k]];
+        const Matx33d &Ki = cam.getKinv();
+        double u = Ki(0,0)*pts[k].x + Ki(0,1)*pts[k].y + Ki(0,2);
+        double v = Ki(1,0)*pts[k].x + Ki(1,1)*pts[k].y + Ki(1,2);
+        accumulateTriangulationRows(cam.getP(), u, v, G[k], h[k]);
+        w[k] = 1;
+    }
     
-    if ((imSize.width == 0) && (imSize.height == 0)) {
-        for (int i = 0; i < pts3D.size(); i++) {
-            //project point to 2d
-            Matx31d pt = Pmat*Matx41d(pts3D[i].val[0],pts3D[i].val[1],pts3D[i].val[2],1.0);
-            pts2D.push_back(Point2d(pt.val[0]/pt.val[2],pt.val[1]/pt.val[2]));
+    X = Y = Z = 0;
+    for (int i = 0; i < iter; i++) {
+        //weighted normal equations
+        double N[6] = {0}, r[3] = {0};
+        for (int k = 0; k < m; k++) {
+            double s, Gu[6], hu[3];
+            const double *Gk = Gu, *hk = hu;
+            if (k < C) {
+                s = 1.0/(w[k]*w[k]);
+                Gk = G[k];
+                hk = h[k];
+            }
+            else {
+                const CameraModel &cam = cams[view[k]];
+                const Matx33d &Ki = cam.getKinv();
+                double u = Ki(0,0)*pts[k].x + Ki(0,1)*pts[k].y + Ki(0,2);
+                double v = Ki(1,0)*pts[k].x + Ki(1,1)*pts[k].y + Ki(1,2);
+                double wk = (i == 0) ? 1 : viewDepth(cam.getP(), X, Y, Z);
+                s = 1.0/(wk*wk);
+                accumulateTriangulationRows(cam.getP(), u, v, Gu, hu);
+            }
+            for (int j = 0; j < 6; j++) N[j] += s*Gk[j];
+            for (int j = 0; j < 3; j++) r[j] += s*hk[j];
         }
-    } else {
-        for (int i = 0; i < pts3D.size(); i++) {
-            //project point to 2d
-            Matx31d pt = Pmat*Matx41d(pts3D[i].val[0],pts3D[i].val[1],pts3D[i].val[2],1.0);
-            Point2d pt2d(pt.val[0]/pt.val[2],pt.val[1]/pt.val[2]);
-            if ((pt2d.x >= 0) && (pt2d.x < imSize.width) && (pt2d.y >= 0) && (pt2d.y < imSize.height))
-                pts2D.push_back(pt2d);
+        double x, y, z;
+        solveSymmetric3x3(N, r, x, y, z);
+        
+        //check if time to stop and update weights
+        bool converged = true;
+        for (int k = 0; k < m; k++) {
+            const Matx34d &P = cams[view[k]].getP();
+            double wk = (k < C) ? w[k] : ((i == 0) ? 1 : viewDepth(P, X, Y, Z));
+            double d = viewDepth(P, x, y, z);
+            converged &= fabs(wk - d) <= eps;
+            if (k < C)
+                w[k] = d;
         }
+        X = x;
+        Y = y;
+        Z = z;
+        if (converged)
+            break;
+    }
+}
+
+//RMS reprojection error of a track in pixels and the largest angle between two of its viewing rays in degrees
+static void trackQuality(const CameraModel *cams, const Point3d *centres, const int *view, const Point2d *pts, int m, const Point3d &X, double &error, double &angle) {
+    
+    double e = 0, minCos = 1;
+    for (int k = 0; k < m; k++) {
+        const Matx34d &KP = cams[view[k]].getKP();
+        double iz = 1.0/(KP(2,0)*X.x + KP(2,1)*X.y + KP(2,2)*X.z + KP(2,3));
+        double du = pts[k].x - (KP(0,0)*X.x + KP(0,1)*X.y + KP(0,2)*X.z + KP(0,3))*iz;
+        double dv = pts[k].y - (KP(1,0)*X.x + KP(1,1)*X.y + KP(1,2)*X.z + KP(1,3))*iz;
+        e += du*du + dv*dv;
+        
+        const Point3d &ck = centres[view[k]];
+        double rkx = X.x - ck.x, rky = X.y - ck.y, rkz = X.z - ck.z;
+        for (int j = 0; j < k; j++) {
+            const Point3d &cj = centres[view[j]];
+            double rjx = X.x - cj.x, rjy = X.y - cj.y, rjz = X.z - cj.z;
+            double dot = rkx*rjx + rky*rjy + rkz*rjz;
+            minCos = min(minCos, dot/sqrt((rkx*rkx + rky*rky + rkz*rkz)*(rjx*rjx + rjy*rjy + rjz*rjz)));
+        }
+    }
+    error = sqrt(e/m);
+    angle = acos(max(minCos, -1.0))*180.0/CV_PI;
+}
+
+void GeometryUtils::triangulateTracks(const vector<CameraModel> &cams, const TrackTable &tracks, PointCloud3 &outPts, vector<double> *reprojErrors, vector<double> *angles, int nThreads) {
+    
+    //preallocate output slots so chunks can be written independently
+    size_t n = tracks.size(), offset = outPts.size();
+    size_t errOffset = reprojErrors ? reprojErrors->size() : 0, angOffset = angles ? angles->size() : 0;
+    outPts.resize(offset + n);
+    if (reprojErrors)
+        reprojErrors->resize(errOffset + n);
+    if (angles)
+        angles->resize(angOffset + n);
+    if (n == 0)
+        return;
+    
+    //camera centres -R^T*t for the triangulation angles
+    vector<Point3d> centres(cams.size());
+    for (size_t c = 0; c < cams.size(); c++) {
+        const Matx34d &P = cams[c].getP();
+        centres[c] = Point3d(-(P(0,0)*P(0,3) + P(1,0)*P(1,3) + P(2,0)*P(2,3)), -(P(0,1)*P(0,3) + P(1,1)*P(1,3) + P(2,1)*P(2,3)), -(P(0,2)*P(0,3) + P(1,2)*P(1,3) + P(2,2)*P(2,3)));
+    }
+    
+    double *X = outPts.x() + offset, *Y = outPts.y() + offset, *Z = outPts.z() + offset;
+    double *err = reprojErrors ? &(*reprojErrors)[errOffset] : NULL, *ang = angles ? &(*angles)[angOffset] : NULL;
+    ParallelUtils::parallelFor(n, kTrackChunk, nThreads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            int first = tracks.start[i], m = tracks.length(i);
+            if (m < 2) {
+                X[i] = Y[i] = Z[i] = NAN;
+                if (err)
+                    err[i] = NAN;
+                if (ang)
+                    ang[i] = 0;
+                continue;
+            }
+            
+            triangulateTrack(&cams[0], &tracks.view[first], &tracks.pts[first], m, 10, X[i], Y[i], Z[i]);
+            if (err || ang) {
+                double e, a;
+                trackQuality(&cams[0], &centres[0], &tracks.view[first], &tracks.pts[first], m, Point3d(X[i], Y[i], Z[i]), e, a);
+                if (err)
+                    err[i] = e;
+                if (ang)
+                    ang[i] = a;
+            }
+        }
+    });
+}
+
+//projects the points of a view with the full projection matrix KP, appending those inside the image if imSize is given
+static void appendProjections(const Matx34d &KP, const PointCloud3::View &pts3D, vector<Point2d> &pts2D, const Size &imSize) {
+    
+    bool clip = (imSize.width != 0) || (imSize.height != 0);
+    size_t offset = pts2D.size();
+    pts2D.resize(offset + pts3D.size());
+    
+    size_t k = offset;
+    for (size_t i = 0; i < pts3D.size(); i++) {
+        size_t j = i*pts3D.stride;
+        double x = pts3D.x[j], y = pts3D.y[j], z = pts3D.z[j];
+        double iz = 1.0/(KP(2,0)*x + KP(2,1)*y + KP(2,2)*z + KP(2,3));
+        Point2d pt2d((KP(0,0)*x + KP(0,1)*y + KP(0,2)*z + KP(0,3))*iz, (KP(1,0)*x + KP(1,1)*y + KP(1,2)*z + KP(1,3))*iz);
+        pts2D[k] = pt2d;
+        k += !clip || ((pt2d.x >= 0) && (pt2d.x < imSize.width) && (pt2d.y >= 0) && (pt2d.y < imSize.height));
     }
+    pts2D.resize(k);
+}
+
+void GeometryUtils::projectPoints(const Matx34d &P, const Matx33d &K, const vector<Matx31d> &pts3D, vector<Point2d> &pts2D, Size imSize) {
+    appendProjections(K*P, PointCloud3::View(pts3D), pts2D, imSize);
 }
 
 void GeometryUtils::projectPoints(const Matx34d &P, const Matx33d& K, const vector<Matx31d> &pts3D, vector<Point2i> &pts2D, Size imSize) {
@@ -136,18 +474,16 @@ void GeometryUtils::projectPoints(const Matx34d &P, const Matx33d& K, const vect
 
 void GeometryUtils::projectPoints(const Matx33d &R, const Matx31d &t, const Matx33d &K, const vector<Matx31d> &pts3D, vector<Point2d> &pts2D, Size imSize) {
     
-    Matx34d P;
-    P << R(0,0), R(0,1), R(0,2), t(0), R(1,0), R(1,1), R(1,2), t(1), R(2,0), R(2,1), R(2,2), t(2);
-    
-    projectPoints(P, K, pts3D, pts2D, imSize);
+    projectPoints(CameraModel::poseMatrix(R, t), K, pts3D, pts2D, imSize);
+}
+
+void GeometryUtils::projectPoints(const CameraModel &cam, const PointCloud3::View &pts3D, vector<Point2d> &pts2D, Size imSize) {
+    appendProjections(cam.getKP(), pts3D, pts2D, imSize);
 }
 
 Point2d GeometryUtils::projectPoint(const Matx33d &R, const Matx31d &t, const Matx33d &K, const Matx31d &pt3D) {
     
-    Matx34d P;
-    P << R(0,0), R(0,1), R(0,2), t(0), R(1,0), R(1,1), R(1,2), t(1), R(2,0), R(2,1), R(2,2), t(2);
-    
-    return projectPoint(P, K, pt3D);
+    return projectPoint(CameraModel::poseMatrix(R, t), K, pt3D);
 }
 
 Point2d GeometryUtils::projectPoint(const Matx34d &P, const Matx33d &K, const Matx31d &pt3D) {
@@ -165,109 +501,132 @@ Point2d GeometryUtils::projectPoint(const Matx34d &P, const Matx33d &K, const do
     return res;
 }
 
-bool GeometryUtils::RtFromEssentialMatrix(const Matx33d &E, const Matx33d &K0, const Matx33d &K1, const vector<Point2d> &pts0, const vector<Point2d> &pts1,Matx33d &R, Vec3d &t) {
-    //find SVD of the essential matrix
-    SVD svd(E,SVD::MODIFY_A);
-    
-    const double minSVDRatio = 0.7;
-    const double minGoodRatio = 0.85;
-    //    //debug
-    //    cout << "U: " << svd.u << endl;
-    //    cout << "W: " << svd.w << endl;
-    //    cout << "V: " << svd.vt << endl;
-    
-    //two singular values should be equal and the third zero
-    double ratio = fabs(svd.w.ptr<float>(0)[0]/svd.w.ptr<float>(0)[1]);
-    if (ratio < 0.7) {
-        cerr << "singular values too far apart" << endl;
-        return false;
+template <typename T>
+static int cheiralityVoteImpl(const vector<Matx34d> &candidates, const Matx33d &K0, const Matx33d &K1, const vector<Point_<T> > &pts0, const vector<Point_<T> > &pts1, vector<int> &votes, int &nEvaluated, int maxPoints, double minDepth, uint64 seed, double minRatio = 0) {
+    
+    const int L = kTriangulationLanes;
+    int nCand = (int)candidates.size();
+    int n = (int)pts0.size();
+    votes.assign(nCand, 0);
+    nEvaluated = 0;
+    if ((nCand == 0) || (n == 0))
+        return -1;
+    
+    //pick a deterministic random subset if requested
+    vector<int> idx;
+    if ((maxPoints > 0) && (maxPoints < n)) {
+        idx.resize(n);
+        iota(idx.begin(), idx.end(), 0);
+        RNG rng(seed);
+        for (int k = 0; k < maxPoints; k++)
+            swap(idx[k], idx[rng.uniform(k, n)]);
+        n = maxPoints;
     }
     
-    Matx33d W(0,-1,0,1,0,0,0,0,1);
-    Matx33d Wt(0,1,0,-1,0,0,0,0,1);
-    
-    Mat R0 = svd.u*Mat(W)*svd.vt;
-    Mat R1 = svd.u*Mat(Wt)*svd.vt;
-    Mat t0 = svd.u.col(2);
-    Mat t1 = -svd.u.col(2);
-    
-    //calculate determinant of rotation to check validity of essential matrix
-    double d = determinant(R0);
-    double tol = 1e-05;
-    if (d + 1.0 < tol) {
-        svd(-E,SVD::MODIFY_A);
-        R0 = svd.u*Mat(W)*svd.vt;
-        R1 = svd.u*Mat(Wt)*svd.vt;
-        t0 = svd.u.col(2);
-        t1 = -svd.u.col(2);
-        d = determinant(R0);
-    }
-    if (d -1.0 > tol) {
-        cerr << "Not a proper rotation" << endl;
-        return false;
-    }
-    
-    //test all possibilities
     Matx34d P0(1,0,0,0,0,1,0,0,0,0,1,0);
-    vector<Mat> rots{R0,R1};
-    vector<Mat> trans{t0,t1};
-    vector<Matx31d> pts3D;
-    int bestCount = 0, bestRIdx, bestTIdx;
-    for (int i = 0; i < 2; i++) {
-        for (int j = 0; j < 2; j++) {
-            //triangulate points
-            //TODO: only triangulate a subset to limit complexity?
-            pts3D.clear();
-            Matx34d P(rots[i].ptr<float>(0)[0],rots[i].ptr<float>(0)[1],rots[i].ptr<float>(0)[2],trans[j].ptr<float>(0)[0],rots[i].ptr<float>(1)[0],rots[i].ptr<float>(1)[1],rots[i].ptr<float>(1)[2],trans[j].ptr<float>(0)[1],rots[i].ptr<float>(2)[0],rots[i].ptr<float>(2)[1],rots[i].ptr<float>(2)[2],trans[j].ptr<float>(0)[2]);
-            triangulatePoints(P0,P,K0,K1,pts0,pts1,pts3D);
-            
-            //check if points are in front of the camera plane
-            int countGood = 0;
-            for (int k = 0; k < pts3D.size(); k++) {
-                if (pts3D[k].val[2] > 1)
-                    countGood++;
-            }
-            
-            //save best transformation
-            if (countGood > bestCount) {
-                bestCount = countGood;
-                bestRIdx = i;
-                bestTIdx = j;
+    Matx33d K0i = K0.inv();
+    Matx33d K1i = K1.inv();
+    double u0[L], v0[L], u1[L], v1[L], X[L], Y[L], Z[L];
+    for (int b = 0; b < n; b += L) {
+        //convert to normalised coordinates
+        for (int l = 0; l < L; l++) {
+            int k = min(b + l, n - 1);
+            if (!idx.empty())
+                k = idx[k];
+            u0[l] = K0i(0,0)*pts0[k].x + K0i(0,1)*pts0[k].y + K0i(0,2);
+            v0[l] = K0i(1,0)*pts0[k].x + K0i(1,1)*pts0[k].y + K0i(1,2);
+            u1[l] = K1i(0,0)*pts1[k].x + K1i(0,1)*pts1[k].y + K1i(0,2);
+            v1[l] = K1i(1,0)*pts1[k].x + K1i(1,1)*pts1[k].y + K1i(1,2);
+        }
+        
+        //a single unweighted solve is enough to get the sign of the depth
+        int m = min(L, n - b);
+        for (int c = 0; c < nCand; c++) {
+            triangulateBlock(P0, candidates[c], u0, v0, u1, v1, 1, X, Y, Z);
+            for (int l = 0; l < m; l++)
+                votes[c] += Z[l] > minDepth;
+        }
+        nEvaluated += m;
+        
+        //stop once the leader cannot be caught by the runner up, and whether it reaches minRatio of the n votes is settled too
+        int first = 0, second = 0;
+        for (int c = 0; c < nCand; c++) {
+            if (votes[c] > first) {
+                second = first;
+                first = votes[c];
             }
+            else if (votes[c] > second)
+                second = votes[c];
         }
+        int remaining = n - nEvaluated;
+        bool ratioSettled = (first >= minRatio*n) || (first + remaining < minRatio*n);
+        if ((first - second > remaining) && ratioSettled)
+            break;
     }
     
-    if (bestCount/pts3D.size() < minGoodRatio) {
-        cerr << "No valid rotations/translations" << endl;
-        return false;
+    int bestIdx = -1, bestCount = 0;
+    for (int c = 0; c < nCand; c++) {
+        if (votes[c] > bestCount) {
+            bestCount = votes[c];
+            bestIdx = c;
+        }
     }
+    return bestIdx;
+}
+
+int GeometryUtils::cheiralityVote(const vector<Matx34d> &candidates, const Matx33d &K0, const Matx33d &K1, const vector<Point2d> &pts0, const vector<Point2d> &pts1, vector<int> &votes, int &nEvaluated, int maxPoints, double minDepth, uint64 seed) {
+    return cheiralityVoteImpl(candidates, K0, K1, pts0, pts1, votes, nEvaluated, maxPoints, minDepth, seed);
+}
+
+int GeometryUtils::cheiralityVote(const vector<Matx34d> &candidates, const Matx33d &K0, const Matx33d &K1, const vector<Point2f> &pts0, const vector<Point2f> &pts1, vector<int> &votes, int &nEvaluated, int maxPoints, double minDepth, uint64 seed) {
+    return cheiralityVoteImpl(candidates, K0, K1, pts0, pts1, votes, nEvaluated, maxPoints, minDepth, seed);
+}
+
+//chooses among the candidate poses [R|t] of view 1 the one that puts the correspondences in front of both cameras
+template <typename T>
+static int bestPoseCandidate(const vector<Matx34d> &candidates, const Matx33d &K0, const Matx33d &K1, const vector<Point_<T> > &pts0, const vector<Point_<T> > &pts1, vector<int> *votes) {
     
-    R = rots[bestRIdx];
-    t = trans[bestTIdx];
-    
-    return true;
+    const double minGoodRatio = 0.85;
+    vector<int> candVotes;
+    int nEvaluated = 0;
+    int bestIdx = cheiralityVoteImpl(candidates, K0, K1, pts0, pts1, candVotes, nEvaluated, 0, 1.0, 0x5eed, minGoodRatio);
+    if (votes)
+        *votes = candVotes;
+    
+    //voting only stops early once this test gives the same answer as over all the correspondences
+    if ((bestIdx < 0) || (candVotes[bestIdx] < minGoodRatio*pts0.size())) {
+        cerr << "No valid rotations/translations" << endl;
+        return -1;
+    }
+    return bestIdx;
 }
 
-bool GeometryUtils::RtFromEssentialMatrix(const Matx33f &E, const Matx33f &K0, const Matx33f &K1, const vector<Point2f> &pts0, const vector<Point2f> &pts1,Matx33d &R, Vec3d &t) {
+static Matx34d poseCandidate(const Mat &R, const Mat &t) {
+    Matx33d Ri(R);
+    Vec3d ti(t);
+    return Matx34d(Ri(0,0),Ri(0,1),Ri(0,2),ti[0],Ri(1,0),Ri(1,1),Ri(1,2),ti[1],Ri(2,0),Ri(2,1),Ri(2,2),ti[2]);
+}
+
+template <typename T>
+static bool RtFromEssential(const Matx<T,3,3> &E, const Matx<T,3,3> &K0, const Matx<T,3,3> &K1, const vector<Point_<T> > &pts0, const vector<Point_<T> > &pts1, Matx33d &R, Vec3d &t, vector<int> *votes) {
     //find SVD of the essential matrix
     SVD svd(E,SVD::MODIFY_A);
     
     const double minSVDRatio = 0.7;
-    const double minGoodRatio = 0.85;
     //    //debug
     //    cout << "U: " << svd.u << endl;
     //    cout << "W: " << svd.w << endl;
     //    cout << "V: " << svd.vt << endl;
     
     //two singular values should be equal and the third zero
-    double ratio = fabs(svd.w.ptr<float>(0)[1]/svd.w.ptr<float>(0)[0]);
-    if (ratio < 0.7) {
+    double ratio = fabs(svd.w.ptr<T>(0)[1]/svd.w.ptr<T>(0)[0]);
+    if (ratio < minSVDRatio) {
         cerr << "singular values too far apart" << endl;
         return false;
     }
     
-    Matx33f W(0,-1,0,1,0,0,0,0,1);
-    Matx33f Wt(0,1,0,-1,0,0,0,0,1);
+    Matx<T,3,3> W(0,-1,0,1,0,0,0,0,1);
+    Matx<T,3,3> Wt(0,1,0,-1,0,0,0,0,1);
     
     Mat R0 = svd.u*Mat(W)*svd.vt;
     Mat R1 = svd.u*Mat(Wt)*svd.vt;
@@ -291,48 +650,26 @@ bool GeometryUtils::RtFromEssentialMatrix(const Matx33f &E, const Matx33f &K0, c
     }
     
     //test all possibilities
-    Matx34d P0(1,0,0,0,0,1,0,0,0,0,1,0);
     vector<Mat> rots{R0,R1};
     vector<Mat> trans{t0,t1};
-    vector<Matx31d> pts3D;
-    int bestCount = 0, bestRIdx, bestTIdx;
-    for (int i = 0; i < 2; i++) {
-        for (int j = 0; j < 2; j++) {
-            //triangulate points
-            //TODO: only triangulate a subset to limit complexity?
-            pts3D.clear();
-            Matx34d P(rots[i].ptr<float>(0)[0],rots[i].ptr<float>(0)[1],rots[i].ptr<float>(0)[2],trans[j].ptr<float>(0)[0],rots[i].ptr<float>(1)[0],rots[i].ptr<float>(1)[1],rots[i].ptr<float>(1)[2],trans[j].ptr<float>(0)[1],rots[i].ptr<float>(2)[0],rots[i].ptr<float>(2)[1],rots[i].ptr<float>(2)[2],trans[j].ptr<float>(0)[2]);
-            triangulatePoints(P0,P,K0,K1,pts0,pts1,pts3D);
-            
-            //check if points are in front of the camera plane
-            int countGood = 0;
-            for (int k = 0; k < pts3D.size(); k++) {
-                if (pts3D[k].val[2] > 1)
-                    countGood++;
-            }
-            
-            //save best transformation
-            if (countGood >= bestCount) {
-                bestCount = countGood;
-                bestRIdx = i;
-                bestTIdx = j;
-            }
-        }
-    }
-    
-    if ((float)bestCount/pts3D.size() < minGoodRatio) {
-        cerr << "No valid rotations/translations" << endl;
+    vector<Matx34d> candidates;
+    for (int i = 0; i < 2; i++)
+        for (int j = 0; j < 2; j++)
+            candidates.push_back(poseCandidate(rots[i], trans[j]));
+    
+    //check which pose puts the points in front of the camera plane
+    int bestIdx = bestPoseCandidate(candidates, Matx33d(K0), Matx33d(K1), pts0, pts1, votes);
+    if (bestIdx < 0)
         return false;
-    }
     
-    R = Matx33d(rots[bestRIdx]);
-    t = Vec3d(trans[bestTIdx]);
+    R = Matx33d(rots[bestIdx/2]);
+    t = Vec3d(trans[bestIdx%2]);
     
     return true;
 }
 
-bool GeometryUtils::RtFromHomographyMatrix(const Matx33f &H, const Matx33f &K0, const Matx33f &K1, const vector<Point2f> &pts0, const vector<Point2f> &pts1, Matx33d &R, Vec3d &t) {
-    const double minGoodRatio = 0.85;
+template <typename T>
+static bool RtFromHomography(const Matx<T,3,3> &H, const Matx<T,3,3> &K0, const Matx<T,3,3> &K1, const vector<Point_<T> > &pts0, const vector<Point_<T> > &pts1, Matx33d &R, Vec3d &t, vector<int> *votes) {
     
     //find all possible decompositions
     vector<Mat> rots;
@@ -340,36 +677,15 @@ bool GeometryUtils::RtFromHomographyMatrix(const Matx33f &H, const Matx33f &K0,
     vector<Mat> nh;
     decomposeHomographyMat(H, K0, rots, trans, nh); //OpenCV implementation takes only one intrinsic
     
-    //try triangulating
-    Matx34d P0(1,0,0,0,0,1,0,0,0,0,1,0);
-    vector<Matx31d> pts3D;
-    int bestCount = 0, bestIdx;
-    for (int i = 0; i < rots.size(); i++) {
-        
-        //triangulate points
-        //TODO: only triangulate a subset to limit complexity?
-        pts3D.clear();
-        Matx34d P(rots[i].ptr<double>(0)[0],rots[i].ptr<double>(0)[1],rots[i].ptr<double>(0)[2],trans[i].ptr<double>(0)[0],rots[i].ptr<double>(1)[0],rots[i].ptr<double>(1)[1],rots[i].ptr<double>(1)[2],trans[i].ptr<double>(0)[1],rots[i].ptr<double>(2)[0],rots[i].ptr<double>(2)[1],rots[i].ptr<double>(2)[2],trans[i].ptr<double>(0)[2]);
-        triangulatePoints(P0,P,K0,K1,pts0,pts1,pts3D);
-        
-        //check if points are in front of the camera
-        int countGood = 0;
-        for (int k = 0; k < pts3D.size(); k++) {
-            if (pts3D[k].val[2] > 1)
-                countGood++;
-        }
-        
-        //save best transformation
-        if (countGood > bestCount) {
-            bestCount = countGood;
-            bestIdx = i;
-        }
-    }
+    //build candidate projection matrices
+    vector<Matx34d> candidates;
+    for (int i = 0; i < rots.size(); i++)
+        candidates.push_back(poseCandidate(rots[i], trans[i]));
     
-    if ((float)bestCount/pts3D.size() < minGoodRatio) {
-        cerr << "No valid rotations/translations" << endl;
+    //check which decomposition puts the points in front of the camera
+    int bestIdx = bestPoseCandidate(candidates, Matx33d(K0), Matx33d(K1), pts0, pts1, votes);
+    if (bestIdx < 0)
         return false;
-    }
     
     R = Matx33d(rots[bestIdx]);
     t = Vec3d(trans[bestIdx]);
@@ -377,100 +693,434 @@ bool GeometryUtils::RtFromHomographyMatrix(const Matx33f &H, const Matx33f &K0,
     return true;
 }
 
-double GeometryUtils::distancePointLine2D(const Point2d &pt, const Vec3d &l) {
-    return (l[0]*pt.x + l[1]*pt.y + l[2])*(l[0]*pt.x + l[1]*pt.y + l[2])/(l[0]*l[0] + l[1]*l[1]);
+bool GeometryUtils::RtFromEssentialMatrix(const Matx33d &E, const Matx33d &K0, const Matx33d &K1, const vector<Point2d> &pts0, const vector<Point2d> &pts1, Matx33d &R, Vec3d &t, vector<int> *votes) {
+    return RtFromEssential(E, K0, K1, pts0, pts1, R, t, votes);
 }
 
-double GeometryUtils::calculateFundamentalAvgError(const vector<Point2d> &pts0, const vector<Point2d> &pts1, const Matx33d &F) {
-    //return average symmetric distance from epilines
-    double e = 0;
+bool GeometryUtils::RtFromEssentialMatrix(const Matx33f &E, const Matx33f &K0, const Matx33f &K1, const vector<Point2f> &pts0, const vector<Point2f> &pts1, Matx33d &R, Vec3d &t, vector<int> *votes) {
+    return RtFromEssential(E, K0, K1, pts0, pts1, R, t, votes);
+}
+
+bool GeometryUtils::RtFromHomographyMatrix(const Matx33d &H, const Matx33d &K0, const Matx33d &K1, const vector<Point2d> &pts0, const vector<Point2d> &pts1, Matx33d &R, Vec3d &t, vector<int> *votes) {
+    return RtFromHomography(H, K0, K1, pts0, pts1, R, t, votes);
+}
+
+bool GeometryUtils::RtFromHomographyMatrix(const Matx33f &H, const Matx33f &K0, const Matx33f &K1, const vector<Point2f> &pts0, const vector<Point2f> &pts1, Matx33d &R, Vec3d &t, vector<int> *votes) {
+    return RtFromHomography(H, K0, K1, pts0, pts1, R, t, votes);
+}
+
+//five-point essential matrix: cubic polynomials in the null space coefficients (x,y,z), stored in the monomial order of Nister's
+//action matrix so that Gauss-Jordan elimination of the first ten columns leaves the rows used to build the degree 10 polynomial
+static const int kFivePointMonomials = 20;
+static const int kMonomialExponents[kFivePointMonomials][3] = {
+    {3,0,0}, {0,3,0}, {2,1,0}, {1,2,0}, {2,0,1}, {2,0,0}, {0,2,1}, {0,2,0}, {1,1,1}, {1,1,0},
+    {1,0,2}, {1,0,1}, {1,0,0}, {0,1,2}, {0,1,1}, {0,1,0}, {0,0,3}, {0,0,2}, {0,0,1}, {0,0,0}
+};
+
+struct CubicPoly {
+    double c[kFivePointMonomials];
+};
+
+//index of the product of two monomials (-1 above degree 3) and the monomials of degree at most d
+struct MonomialProducts {
+    int index[kFivePointMonomials][kFivePointMonomials];
+    int upToDegree[4][kFivePointMonomials];
+    int nUpToDegree[4];
+    
+    MonomialProducts() {
+        int lookup[4][4][4];
+        for (int d = 0; d < 4; d++)
+            nUpToDegree[d] = 0;
+        for (int i = 0; i < kFivePointMonomials; i++) {
+            const int *e = kMonomialExponents[i];
+            lookup[e[0]][e[1]][e[2]] = i;
+            for (int d = e[0] + e[1] + e[2]; d < 4; d++)
+                upToDegree[d][nUpToDegree[d]++] = i;
+        }
+        for (int a = 0; a < kFivePointMonomials; a++)
+            for (int b = 0; b < kFivePointMonomials; b++) {
+                int e0 = kMonomialExponents[a][0] + kMonomialExponents[b][0];
+                int e1 = kMonomialExponents[a][1] + kMonomialExponents[b][1];
+                int e2 = kMonomialExponents[a][2] + kMonomialExponents[b][2];
+                index[a][b] = (e0 + e1 + e2 <= 3) ? lookup[e0][e1][e2] : -1;
+            }
+    }
+};
+
+static const MonomialProducts kMonomialProducts;
+
+//out += s*a*b for polynomials a and b of degrees da and db, da + db <= 3
+static inline void cubicMulAdd(const CubicPoly &a, int da, const CubicPoly &b, int db, double s, CubicPoly &out) {
+    const int *ia = kMonomialProducts.upToDegree[da], *ib = kMonomialProducts.upToDegree[db];
+    int na = kMonomialProducts.nUpToDegree[da], nb = kMonomialProducts.nUpToDegree[db];
+    for (int i = 0; i < na; i++) {
+        double ai = s*a.c[ia[i]];
+        const int *prod = kMonomialProducts.index[ia[i]];
+        for (int j = 0; j < nb; j++)
+            out.c[prod[ib[j]]] += ai*b.c[ib[j]];
+    }
+}
+
+//product of polynomials in z of degrees na and nb
+static inline void zPolyMul(const double *a, int na, const double *b, int nb, double *out) {
+    for (int i = 0; i <= na + nb; i++)
+        out[i] = 0;
+    for (int i = 0; i <= na; i++)
+        for (int j = 0; j <= nb; j++)
+            out[i + j] += a[i]*b[j];
+}
+
+//coefficients in z of the x, y and constant terms of <e> - z*<f>, e and f being the reduced rows of two leading monomials
+//that differ by a factor z. The tail monomials are xz^2, xz, x, yz^2, yz, y, z^3, z^2, z, 1
+static inline void zPolyRow(const double *e, const double *f, double *px, double *py, double *p1) {
+    px[0] = e[2]; px[1] = e[1] - f[2]; px[2] = e[0] - f[1]; px[3] = -f[0];
+    py[0] = e[5]; py[1] = e[4] - f[5]; py[2] = e[3] - f[4]; py[3] = -f[3];
+    p1[0] = e[9]; p1[1] = e[8] - f[9]; p1[2] = e[7] - f[8]; p1[3] = e[6] - f[7]; p1[4] = -f[6];
+}
+
+int GeometryUtils::essentialFromFivePoints(const Point2d *pts0, const Point2d *pts1, Matx33d *E) {
+    
+    //epipolar constraints x1^T*E*x0 = 0 on the row-major entries of E
+    double Q[5][9];
+    for (int i = 0; i < 5; i++) {
+        double x0 = pts0[i].x, y0 = pts0[i].y, x1 = pts1[i].x, y1 = pts1[i].y;
+        double r[9] = {x1*x0, x1*y0, x1, y1*x0, y1*y0, y1, x0, y0, 1};
+        for (int j = 0; j < 9; j++)
+            Q[i][j] = r[j];
+    }
+    
+    //4 dimensional null space by Gauss-Jordan elimination with full pivoting
+    int pivotCol[5];
+    bool isPivot[9] = {false};
+    for (int r = 0; r < 5; r++) {
+        int pr = -1, pc = -1;
+        double best = 0;
+        for (int i = r; i < 5; i++)
+            for (int j = 0; j < 9; j++)
+                if (!isPivot[j] && (fabs(Q[i][j]) > best)) {
+                    best = fabs(Q[i][j]);
+                    pr = i;
+                    pc = j;
+                }
+        if (best < 1e-12)
+            return 0;
+        for (int j = 0; j < 9; j++)
+            swap(Q[r][j], Q[pr][j]);
+        double s = 1.0/Q[r][pc];
+        for (int j = 0; j < 9; j++)
+            Q[r][j] *= s;
+        for (int i = 0; i < 5; i++) {
+            if (i == r)
+                continue;
+            double f = Q[i][pc];
+            for (int j = 0; j < 9; j++)
+                Q[i][j] -= f*Q[r][j];
+        }
+        pivotCol[r] = pc;
+        isPivot[pc] = true;
+    }
+    double basis[4][9];
+    for (int b = 0, f = 0; f < 9; f++) {
+        if (isPivot[f])
+            continue;
+        for (int j = 0; j < 9; j++)
+            basis[b][j] = 0;
+        basis[b][f] = 1;
+        for (int r = 0; r < 5; r++)
+            basis[b][pivotCol[r]] = -Q[r][f];
+        b++;
+    }
     
-    //compute epipolar lines
-    vector<Vec3d> epiLines0, epiLines1;
-    computeCorrespondEpilines(pts0, 1, F, epiLines1);
-    computeCorrespondEpilines(pts1, 2, F, epiLines0);
+    //E = x*X + y*Y + z*Z + W
+    CubicPoly e[3][3];
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++) {
+            CubicPoly &p = e[i][j];
+            for (int k = 0; k < kFivePointMonomials; k++)
+                p.c[k] = 0;
+            p.c[12] = basis[0][i*3 + j];
+            p.c[15] = basis[1][i*3 + j];
+            p.c[18] = basis[2][i*3 + j];
+            p.c[19] = basis[3][i*3 + j];
+        }
     
-    double e01,e10;
+    //ten cubic constraints: det(E) = 0 and 2*E*E^T*E - trace(E*E^T)*E = 0
+    double A[10][kFivePointMonomials] = {{0}};
+    CubicPoly EEt[3][3], minor, tr = CubicPoly();
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++) {
+            EEt[i][j] = CubicPoly();
+            for (int k = 0; k < 3; k++)
+                cubicMulAdd(e[i][k], 1, e[j][k], 1, 1, EEt[i][j]);
+        }
+    for (int k = 0; k < kFivePointMonomials; k++)
+        tr.c[k] = EEt[0][0].c[k] + EEt[1][1].c[k] + EEt[2][2].c[k];
+    
+    CubicPoly det = CubicPoly();
+    for (int j = 0; j < 3; j++) {
+        int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+        minor = CubicPoly();
+        cubicMulAdd(e[1][j1], 1, e[2][j2], 1, 1, minor);
+        cubicMulAdd(e[1][j2], 1, e[2][j1], 1, -1, minor);
+        cubicMulAdd(e[0][j], 1, minor, 2, 1, det);
+    }
+    for (int k = 0; k < kFivePointMonomials; k++)
+        A[0][k] = det.c[k];
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++) {
+            CubicPoly c = CubicPoly();
+            for (int k = 0; k < 3; k++)
+                cubicMulAdd(EEt[i][k], 2, e[k][j], 1, 2, c);
+            cubicMulAdd(tr, 2, e[i][j], 1, -1, c);
+            for (int k = 0; k < kFivePointMonomials; k++)
+                A[1 + i*3 + j][k] = c.c[k];
+        }
+    
+    //Gauss-Jordan elimination of the first ten monomials
+    for (int c = 0; c < 10; c++) {
+        int pr = c;
+        for (int r = c + 1; r < 10; r++)
+            if (fabs(A[r][c]) > fabs(A[pr][c]))
+                pr = r;
+        if (fabs(A[pr][c]) < 1e-14)
+            return 0;
+        for (int k = 0; k < kFivePointMonomials; k++)
+            swap(A[c][k], A[pr][k]);
+        double s = 1.0/A[c][c];
+        for (int k = c; k < kFivePointMonomials; k++)
+            A[c][k] *= s;
+        for (int r = 0; r < 10; r++) {
+            if (r == c)
+                continue;
+            double f = A[r][c];
+            if (f == 0)
+                continue;
+            for (int k = c; k < kFivePointMonomials; k++)
+                A[r][k] -= f*A[c][k];
+        }
+    }
+    
+    //<k> = <x^2z> - z<x^2>, <l> = <y^2z> - z<y^2>, <m> = <xyz> - z<xy> are linear in x and y; [x y 1]^T is in the null space
+    //of their 3x3 matrix of polynomials in z, whose degree 10 determinant gives z
+    double kx[4], ky[4], k1[5], lx[4], ly[4], l1[5], mx[4], my[4], m1[5];
+    zPolyRow(&A[4][10], &A[5][10], kx, ky, k1);
+    zPolyRow(&A[6][10], &A[7][10], lx, ly, l1);
+    zPolyRow(&A[8][10], &A[9][10], mx, my, m1);
+    
+    double t0[8], t1[8], t2[7], t3[7], p[11], q[11];
+    for (int i = 0; i <= 10; i++)
+        p[i] = 0;
+    zPolyMul(ly, 3, m1, 4, t0);
+    zPolyMul(l1, 4, my, 3, t1);
+    for (int i = 0; i <= 7; i++)
+        t0[i] -= t1[i];
+    zPolyMul(kx, 3, t0, 7, q);
+    for (int i = 0; i <= 10; i++)
+        p[i] += q[i];
+    zPolyMul(lx, 3, m1, 4, t0);
+    zPolyMul(l1, 4, mx, 3, t1);
+    for (int i = 0; i <= 7; i++)
+        t0[i] -= t1[i];
+    zPolyMul(ky, 3, t0, 7, q);
+    for (int i = 0; i <= 10; i++)
+        p[i] -= q[i];
+    zPolyMul(lx, 3, my, 3, t2);
+    zPolyMul(ly, 3, mx, 3, t3);
+    for (int i = 0; i <= 6; i++)
+        t2[i] -= t3[i];
+    zPolyMul(k1, 4, t2, 6, q);
+    for (int i = 0; i <= 10; i++)
+        p[i] += q[i];
+    
+    double roots[10];
+    int nRoots = MathUtils::polynomialRealRoots(p, 10, roots);
+    
+    int nModels = 0;
+    for (int r = 0; r < nRoots; r++) {
+        double z = roots[r];
+        Vec3d rows[3] = {
+            Vec3d(MathUtils::polynomialEval(kx, 3, z), MathUtils::polynomialEval(ky, 3, z), MathUtils::polynomialEval(k1, 4, z)),
+            Vec3d(MathUtils::polynomialEval(lx, 3, z), MathUtils::polynomialEval(ly, 3, z), MathUtils::polynomialEval(l1, 4, z)),
+            Vec3d(MathUtils::polynomialEval(mx, 3, z), MathUtils::polynomialEval(my, 3, z), MathUtils::polynomialEval(m1, 4, z))
+        };
+        
+        //null vector from the best conditioned pair of rows
+        Vec3d v = rows[0].cross(rows[1]);
+        Vec3d v1 = rows[0].cross(rows[2]), v2 = rows[1].cross(rows[2]);
+        if (v1.dot(v1) > v.dot(v))
+            v = v1;
+        if (v2.dot(v2) > v.dot(v))
+            v = v2;
+        if (fabs(v[2]) < 1e-12*sqrt(v.dot(v)) || (v[2] == 0))
+            continue;
+        double x = v[0]/v[2], y = v[1]/v[2];
+        
+        Matx33d &Ei = E[nModels];
+        double norm = 0;
+        for (int k = 0; k < 9; k++) {
+            Ei.val[k] = x*basis[0][k] + y*basis[1][k] + z*basis[2][k] + basis[3][k];
+            norm += Ei.val[k]*Ei.val[k];
+        }
+        Ei *= 1.0/sqrt(norm);
+        nModels++;
+    }
+    return nModels;
+}
+
+double GeometryUtils::distancePointLine2D(const Point2d &pt, const Vec3d &l) {
+    return (l[0]*pt.x + l[1]*pt.y + l[2])*(l[0]*pt.x + l[1]*pt.y + l[2])/(l[0]*l[0] + l[1]*l[1]);
+}
+
+//Epipolar residuals in batches of one 256 bit register of T (4 doubles or 8 floats): the epipolar lines F*x0 and F^T*x1 of each batch
+//are computed in registers and never stored
+template <typename T>
+static int epipolarResidualsKernel(const Matx<T,3,3> &F, const Point_<T> *pts0, const Point_<T> *pts1, size_t n, T *residuals, uchar *status, T maxResidual, int type) {
+    
+    const int L = 32/sizeof(T);
+    bool sampson = (type == GeometryUtils::EPIPOLAR_SAMPSON);
+    T res[L];
     int count = 0;
-    for (int i = 0; i < pts0.size(); i++) {
-        //compute distance from epilines
-        e01 = GeometryUtils::distancePointLine2D(pts0[i], epiLines0[i]);
-        e10 = GeometryUtils::distancePointLine2D(pts1[i], epiLines1[i]);
-        e += e10 + e01;
-        count++;
+    for (size_t b = 0; b < n; b += L) {
+        int m = (int)min((size_t)L, n - b);
+        const Point_<T> *p0 = pts0 + b, *p1 = pts1 + b;
+        for (int l = 0; l < m; l++) {
+            T x0 = p0[l].x, y0 = p0[l].y, x1 = p1[l].x, y1 = p1[l].y;
+            //epiline of x0 in image 1 and of x1 in image 0
+            T a1 = F(0,0)*x0 + F(0,1)*y0 + F(0,2);
+            T b1 = F(1,0)*x0 + F(1,1)*y0 + F(1,2);
+            T c1 = F(2,0)*x0 + F(2,1)*y0 + F(2,2);
+            T a0 = F(0,0)*x1 + F(1,0)*y1 + F(2,0);
+            T b0 = F(0,1)*x1 + F(1,1)*y1 + F(2,1);
+            //x1^T*F*x0 is the unnormalised distance from both lines
+            T r = a1*x1 + b1*y1 + c1;
+            T r2 = r*r, n1 = a1*a1 + b1*b1, n0 = a0*a0 + b0*b0;
+            res[l] = sampson ? r2/(n0 + n1) : r2/n0 + r2/n1;
+        }
+        
+        for (int l = 0; l < m; l++)
+            count += !(res[l] < maxResidual);
+        if (status) {
+            for (int l = 0; l < m; l++)
+                status[b + l] = res[l] < maxResidual;
+        }
+        if (residuals)
+            memcpy(residuals + b, res, m*sizeof(T));
     }
+    return count;
+}
+
+//average symmetric distance from epilines through the streaming kernel, accumulated in double
+template <typename T>
+static double fundamentalAvgError(const vector<Point_<T> > &pts0, const vector<Point_<T> > &pts1, const Matx<T,3,3> &F) {
     
-    return e/count;
+    const size_t bufSize = 256;
+    T res[bufSize];
+    double e = 0;
+    size_t n = pts0.size();
+    for (size_t b = 0; b < n; b += bufSize) {
+        size_t m = min(bufSize, n - b);
+        epipolarResidualsKernel(F, &pts0[b], &pts1[b], m, res, (uchar*)NULL, numeric_limits<T>::max(), GeometryUtils::EPIPOLAR_SYMMETRIC);
+        for (size_t i = 0; i < m; i++)
+            e += res[i];
+    }
+    return e/n;
+}
+
+//appends the epipolar status of every correspondence, optionally rejecting points not in front of the camera
+template <typename T>
+static int filterMatchesStreaming(const Matx<T,3,3> &F, const vector<Point_<T> > &pts0, const vector<Point_<T> > &pts1, const vector<Matx31d> *pts3D, vector<uchar> &status, double distThreshold) {
+    
+    size_t n = pts0.size();
+    size_t offset = status.size();
+    status.resize(offset + n);
+    if (n == 0)
+        return 0;
+    
+    //the mean of the two square distances is tested against the square threshold
+    T maxResidual = (T)(2*distThreshold*distThreshold);
+    int count = epipolarResidualsKernel(F, &pts0[0], &pts1[0], n, (T*)NULL, &status[offset], maxResidual, GeometryUtils::EPIPOLAR_SYMMETRIC);
+    
+    //check also that point is in front of the camera
+    if (pts3D) {
+        for (size_t i = 0; i < n; i++) {
+            if (status[offset + i] && ((*pts3D)[i](2) <= 1.0)) {
+                status[offset + i] = 0;
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+int GeometryUtils::epipolarResiduals(const Matx33d &F, const Point2d *pts0, const Point2d *pts1, size_t n, double *residuals, uchar *status, double maxResidual, int type) {
+    return epipolarResidualsKernel(F, pts0, pts1, n, residuals, status, maxResidual, type);
+}
+
+int GeometryUtils::epipolarResiduals(const Matx33f &F, const Point2f *pts0, const Point2f *pts1, size_t n, float *residuals, uchar *status, float maxResidual, int type) {
+    return epipolarResidualsKernel(F, pts0, pts1, n, residuals, status, maxResidual, type);
+}
+
+double GeometryUtils::calculateFundamentalAvgError(const vector<Point2d> &pts0, const vector<Point2d> &pts1, const Matx33d &F) {
+    //return average symmetric distance from epilines
+    return fundamentalAvgError(pts0, pts1, F);
 }
 
 float GeometryUtils::calculateFundamentalAvgError(const vector<Point2f> &pts0, const vector<Point2f> &pts1, const Matx33f &F) {
     //return average symmetric distance from epilines
-    double e = 0;
-    
-    //compute epipolar lines
-    vector<Vec3f> epiLines0, epiLines1;
-    computeCorrespondEpilines(pts0, 1, F, epiLines1);
-    computeCorrespondEpilines(pts1, 2, F, epiLines0);
-    
-    float e01,e10;
-    int count = 0;
-    for (int i = 0; i < pts0.size(); i++) {
-        //compute distance from epilines
-        e01 = GeometryUtils::distancePointLine2D(pts0[i], epiLines0[i]);
-        e10 = GeometryUtils::distancePointLine2D(pts1[i], epiLines1[i]);
-        e += e10 + e01;
-        count++;
+    return fundamentalAvgError(pts0, pts1, F);
+}
+
+//symmetric transfer error of each correspondence, transferring both points on the fly
+template <typename T>
+static void homographyResidualsKernel(const Matx<T,3,3> &H, const Matx<T,3,3> &Hinv, const Point_<T> *pts0, const Point_<T> *pts1, size_t n, T *residuals) {
+    
+    for (size_t i = 0; i < n; i++) {
+        T x0 = pts0[i].x, y0 = pts0[i].y, x1 = pts1[i].x, y1 = pts1[i].y;
+        //forward and backward transformed points
+        T fz = 1/(H(2,0)*x0 + H(2,1)*y0 + H(2,2));
+        T fx = (H(0,0)*x0 + H(0,1)*y0 + H(0,2))*fz;
+        T fy = (H(1,0)*x0 + H(1,1)*y0 + H(1,2))*fz;
+        T bz = 1/(Hinv(2,0)*x1 + Hinv(2,1)*y1 + Hinv(2,2));
+        T bx = (Hinv(0,0)*x1 + Hinv(0,1)*y1 + Hinv(0,2))*bz;
+        T by = (Hinv(1,0)*x1 + Hinv(1,1)*y1 + Hinv(1,2))*bz;
+        residuals[i] = (x1 - fx)*(x1 - fx) + (y1 - fy)*(y1 - fy) + (x0 - bx)*(x0 - bx) + (y0 - by)*(y0 - by);
     }
+}
+
+//average symmetric transfer error through the streaming kernel, accumulated in double
+template <typename T>
+static double homographyAvgError(const vector<Point_<T> > &pts0, const vector<Point_<T> > &pts1, const Matx<T,3,3> &H) {
     
-    return e/count;
+    const size_t bufSize = 256;
+    T res[bufSize];
+    Matx<T,3,3> Hinv = H.inv();
+    double e = 0;
+    size_t n = pts0.size();
+    for (size_t b = 0; b < n; b += bufSize) {
+        size_t m = min(bufSize, n - b);
+        homographyResidualsKernel(H, Hinv, &pts0[b], &pts1[b], m, res);
+        for (size_t i = 0; i < m; i++)
+            e += res[i];
+    }
+    return e/n;
+}
+
+void GeometryUtils::homographyResiduals(const Matx33d &H, const Point2d *pts0, const Point2d *pts1, size_t n, double *residuals) {
+    homographyResidualsKernel(H, H.inv(), pts0, pts1, n, residuals);
+}
+
+void GeometryUtils::homographyResiduals(const Matx33f &H, const Point2f *pts0, const Point2f *pts1, size_t n, float *residuals) {
+    homographyResidualsKernel(H, H.inv(), pts0, pts1, n, residuals);
 }
 
 double GeometryUtils::calculateHomographyAvgError(const vector<Point2d> &pts0, const vector<Point2d> &pts1, const Matx33d &H) {
-    double e = 0;
     //average symmetric transfer error
-    
-    //compute matrix inverse
-    Matx33d Hinv = H.inv();
-    
-    //get forward and backward transformed points
-    vector<Point2d> fwd, bwd;
-    perspectiveTransform(pts0, fwd, H);
-    perspectiveTransform(pts1, bwd, Hinv);
-    
-    double e01, e10;
-    int count = 0;
-    for (int i = 0; i < pts0.size(); i++) {
-        e01 = (pts1[i].x - fwd[i].x)*(pts1[i].x - fwd[i].x) + (pts1[i].y - fwd[i].y)*(pts1[i].y - fwd[i].y);
-        e10 = (pts0[i].x - bwd[i].x)*(pts0[i].x - bwd[i].x) + (pts0[i].y - bwd[i].y)*(pts0[i].y - bwd[i].y);
-        e += e01 + e10;
-        count++;
-    }
-    
-    return e/count;
+    return homographyAvgError(pts0, pts1, H);
 }
 
 float GeometryUtils::calculateHomographyAvgError(const vector<Point2f> &pts0, const vector<Point2f> &pts1, const Matx33f &H) {
-    float e = 0;
     //average symmetric transfer error
-    
-    //compute matrix inverse
-    Matx33f Hinv = H.inv();
-    
-    //get forward and backward transformed points
-    vector<Point2f> fwd, bwd;
-    perspectiveTransform(pts0, fwd, H);
-    perspectiveTransform(pts1, bwd, Hinv);
-    
-    float e01, e10;
-    int count = 0;
-    for (int i = 0; i < pts0.size(); i++) {
-        e01 = (pts1[i].x - fwd[i].x)*(pts1[i].x - fwd[i].x) + (pts1[i].y - fwd[i].y)*(pts1[i].y - fwd[i].y);
-        e10 = (pts0[i].x - bwd[i].x)*(pts0[i].x - bwd[i].x) + (pts0[i].y - bwd[i].y)*(pts0[i].y - bwd[i].y);
-        e += e01 + e10;
-        count++;
-    }
-    
-    return e/count;
+    return homographyAvgError(pts0, pts1, H);
 }
 
 void GeometryUtils::calculateFundamentalMatrix(const Matx33d &K0, const Matx33d &R0, const Matx31d &t0, const Matx33d &K1, const Matx33d &R1, const Matx31d &t1, Matx33d &F) {
@@ -501,159 +1151,155 @@ Matx33d GeometryUtils::getSkewSymmetric(const Matx31d &v) {
     
 }
 
-int GeometryUtils::filterOutliers(const Matx34d &P, const Matx33d &K, const Size &imSize, const vector<Matx31d> &pts3D, const vector<Point2f> &pts2D, vector<uchar> &status, double threshold) {
-    
-    Matx34d Pmat = K*P;
-    double threSq = threshold*threshold;
+//number of points per word of the packed inlier masks
+static const int kMaskBits = 64;
+
+//Projects the points of pts3D with the full projection matrix KP and tests them against their observations. Each block of 64
+//points is projected into local arrays in a branch free loop, then packed into one mask word. The arithmetic is done in the
+//scalar type of the observations, so Point2f observations are tested with a float copy of KP. Stride is the point stride of
+//the view when known at compile time (1 for PointCloud3, 3 for vector<Matx31d>), 0 to read it from the view
+template <typename T, size_t Stride>
+static int projectAndFilterKernel(const Matx<T,3,4> &KP, const Size &imSize, const PointCloud3::View &pts3D, const Point_<T> *pts2D, T threshold, Point2d *proj, double *sqResiduals, uint64 *inlierMask) {
+    
+    T threSq = threshold*threshold;
+    T width = (T)imSize.width, height = (T)imSize.height;
+    T u[kMaskBits], v[kMaskBits], d[kMaskBits];
+    size_t n = pts3D.n, stride = Stride ? Stride : pts3D.stride;
     int count = 0;
-    for (int i = 0; i < pts3D.size(); i++) {
-        //project point to 2d
-        Matx31d pt = Pmat*Matx41d(pts3D[i].val[0],pts3D[i].val[1],pts3D[i].val[2],1.0);
-        pt *= 1.0/pt.val[2];
-        double d = (pts2D[i].x - pt.val[0])*(pts2D[i].x - pt.val[0]) + (pts2D[i].y - pt.val[1])*(pts2D[i].y - pt.val[1]);
+    for (size_t b = 0; b < n; b += kMaskBits) {
+        int m = (int)min((size_t)kMaskBits, n - b);
+        const double *X = pts3D.x + b*stride, *Y = pts3D.y + b*stride, *Z = pts3D.z + b*stride;
+        const Point_<T> *obs = pts2D + b;
+        
+        //project points to 2d and compute distance from the observations
+        for (int l = 0; l < m; l++) {
+            T x = (T)X[l*stride], y = (T)Y[l*stride], z = (T)Z[l*stride];
+            T px = KP(0,0)*x + KP(0,1)*y + KP(0,2)*z + KP(0,3);
+            T py = KP(1,0)*x + KP(1,1)*y + KP(1,2)*z + KP(1,3);
+            T pz = KP(2,0)*x + KP(2,1)*y + KP(2,2)*z + KP(2,3);
+            T iz = 1/pz;
+            u[l] = px*iz;
+            v[l] = py*iz;
+            T du = obs[l].x - u[l], dv = obs[l].y - v[l];
+            d[l] = du*du + dv*dv;
+        }
         
         //check if point is outside the image boundaries or if distance from supposed projection is too large
-        if ((pt.val[0] < 0) || (pt.val[0] >= imSize.width) || (pt.val[1] >= imSize.height) || (pt.val[1] < 0 ) || (d > threSq)) {
-            status.push_back(0);
-            count++;
+        uint64 word = 0;
+        for (int l = 0; l < m; l++) {
+            int outlier = (u[l] < 0) | (u[l] >= width) | (v[l] >= height) | (v[l] < 0) | (d[l] > threSq);
+            word |= (uint64)(1 - outlier) << l;
+            count += outlier;
+        }
+        inlierMask[b/kMaskBits] = word;
+        
+        if (proj) {
+            for (int l = 0; l < m; l++)
+                proj[b + l] = Point2d(u[l], v[l]);
+        }
+        if (sqResiduals) {
+            for (int l = 0; l < m; l++)
+                sqResiduals[b + l] = d[l];
         }
-        else
-            status.push_back(1);
     }
     return count;
 }
 
-int GeometryUtils::filterOutliers(const Matx34d &P, const Matx33d &K, const Size &imSize, const vector<Matx31d> &pts3D, const vector<Point2d> &pts2D, vector<uchar> &status, double threshold) {
+//dispatches to the kernel specialised for the stride of the view, with KP converted to the scalar type of the observations
+template <typename T>
+static int projectAndFilterStrided(const Matx34d &KP, const Size &imSize, const PointCloud3::View &pts3D, const Point_<T> *pts2D, double threshold, Point2d *proj, double *sqResiduals, uint64 *inlierMask) {
+    Matx<T,3,4> KPt = KP;
+    if (pts3D.stride == 1)
+        return projectAndFilterKernel<T,1>(KPt, imSize, pts3D, pts2D, (T)threshold, proj, sqResiduals, inlierMask);
+    if (pts3D.stride == 3)
+        return projectAndFilterKernel<T,3>(KPt, imSize, pts3D, pts2D, (T)threshold, proj, sqResiduals, inlierMask);
+    return projectAndFilterKernel<T,0>(KPt, imSize, pts3D, pts2D, (T)threshold, proj, sqResiduals, inlierMask);
+}
+
+//appends the status of every point to status through the fused kernel, one stack buffer of mask words at a time
+template <typename T>
+static int filterOutliersFused(const Matx34d &KP, const Size &imSize, const PointCloud3::View &pts3D, const vector<Point_<T> > &pts2D, vector<uchar> &status, double threshold) {
+    
+    const size_t nWords = 64;
+    uint64 mask[nWords];
+    size_t n = pts3D.size();
+    size_t offset = status.size();
+    status.resize(offset + n);
     
-    Matx34d Pmat = K*P;
-    double threSq = threshold*threshold;
     int count = 0;
-    for (int i = 0; i < pts3D.size(); i++) {
-        //project point to 2d
-        Matx31d pt = Pmat*Matx41d(pts3D[i].val[0],pts3D[i].val[1],pts3D[i].val[2],1.0);
-        pt *= 1.0/pt.val[2];
-        double d = (pts2D[i].x - pt.val[0])*(pts2D[i].x - pt.val[0]) + (pts2D[i].y - pt.val[1])*(pts2D[i].y - pt.val[1]);
-        
-        //check if point is outside the image boundaries or if distance from supposed projection is too large
-        if ((pt.val[0] < 0) || (pt.val[0] >= imSize.width) || (pt.val[1] >= imSize.height) || (pt.val[1] < 0 ) || (d > threSq)) {
-            status.push_back(0);
-            count++;
-        }
-        else
-            status.push_back(1);
+    for (size_t b = 0; b < n; b += nWords*kMaskBits) {
+        size_t m = min(nWords*kMaskBits, n - b);
+        count += projectAndFilterStrided(KP, imSize, pts3D.subview(b, b + m), &pts2D[b], threshold, (Point2d*)NULL, (double*)NULL, mask);
+        for (size_t i = 0; i < m; i++)
+            status[offset + b + i] = (mask[i/kMaskBits] >> (i%kMaskBits)) & 1;
     }
     return count;
 }
 
+int GeometryUtils::filterOutliers(const Matx34d &P, const Matx33d &K, const Size &imSize, const vector<Matx31d> &pts3D, const vector<Point2f> &pts2D, vector<uchar> &status, double threshold) {
+    return filterOutliersFused(K*P, imSize, PointCloud3::View(pts3D), pts2D, status, threshold);
+}
+
+int GeometryUtils::filterOutliers(const Matx34d &P, const Matx33d &K, const Size &imSize, const vector<Matx31d> &pts3D, const vector<Point2d> &pts2D, vector<uchar> &status, double threshold) {
+    return filterOutliersFused(K*P, imSize, PointCloud3::View(pts3D), pts2D, status, threshold);
+}
+
+int GeometryUtils::projectAndFilter(const Matx34d &P, const Matx33d &K, const Size &imSize, const double *pts3D, const Point2f *pts2D, size_t n, double threshold, Point2d *proj, double *sqResiduals, uint64 *inlierMask) {
+    return projectAndFilterStrided(K*P, imSize, PointCloud3::View(pts3D, pts3D + 1, pts3D + 2, NULL, n, 3), pts2D, threshold, proj, sqResiduals, inlierMask);
+}
+
+int GeometryUtils::projectAndFilter(const Matx34d &P, const Matx33d &K, const Size &imSize, const double *pts3D, const Point2d *pts2D, size_t n, double threshold, Point2d *proj, double *sqResiduals, uint64 *inlierMask) {
+    return projectAndFilterStrided(K*P, imSize, PointCloud3::View(pts3D, pts3D + 1, pts3D + 2, NULL, n, 3), pts2D, threshold, proj, sqResiduals, inlierMask);
+}
+
+int GeometryUtils::filterOutliers(const CameraModel &cam, const Size &imSize, const vector<Matx31d> &pts3D, const vector<Point2f> &pts2D, vector<uchar> &status, double threshold) {
+    return filterOutliersFused(cam.getKP(), imSize, PointCloud3::View(pts3D), pts2D, status, threshold);
+}
+
+int GeometryUtils::filterOutliers(const CameraModel &cam, const Size &imSize, const vector<Matx31d> &pts3D, const vector<Point2d> &pts2D, vector<uchar> &status, double threshold) {
+    return filterOutliersFused(cam.getKP(), imSize, PointCloud3::View(pts3D), pts2D, status, threshold);
+}
+
+int GeometryUtils::projectAndFilter(const CameraModel &cam, const Size &imSize, const double *pts3D, const Point2f *pts2D, size_t n, double threshold, Point2d *proj, double *sqResiduals, uint64 *inlierMask) {
+    return projectAndFilterStrided(cam.getKP(), imSize, PointCloud3::View(pts3D, pts3D + 1, pts3D + 2, NULL, n, 3), pts2D, threshold, proj, sqResiduals, inlierMask);
+}
+
+int GeometryUtils::projectAndFilter(const CameraModel &cam, const Size &imSize, const double *pts3D, const Point2d *pts2D, size_t n, double threshold, Point2d *proj, double *sqResiduals, uint64 *inlierMask) {
+    return projectAndFilterStrided(cam.getKP(), imSize, PointCloud3::View(pts3D, pts3D + 1, pts3D + 2, NULL, n, 3), pts2D, threshold, proj, sqResiduals, inlierMask);
+}
+
+int GeometryUtils::filterOutliers(const CameraModel &cam, const Size &imSize, const PointCloud3::View &pts3D, const vector<Point2f> &pts2D, vector<uchar> &status, double threshold) {
+    return filterOutliersFused(cam.getKP(), imSize, pts3D, pts2D, status, threshold);
+}
+
+int GeometryUtils::filterOutliers(const CameraModel &cam, const Size &imSize, const PointCloud3::View &pts3D, const vector<Point2d> &pts2D, vector<uchar> &status, double threshold) {
+    return filterOutliersFused(cam.getKP(), imSize, pts3D, pts2D, status, threshold);
+}
+
+int GeometryUtils::projectAndFilter(const CameraModel &cam, const Size &imSize, const PointCloud3::View &pts3D, const Point2f *pts2D, double threshold, Point2d *proj, double *sqResiduals, uint64 *inlierMask) {
+    return projectAndFilterStrided(cam.getKP(), imSize, pts3D, pts2D, threshold, proj, sqResiduals, inlierMask);
+}
+
+int GeometryUtils::projectAndFilter(const CameraModel &cam, const Size &imSize, const PointCloud3::View &pts3D, const Point2d *pts2D, double threshold, Point2d *proj, double *sqResiduals, uint64 *inlierMask) {
+    return projectAndFilterStrided(cam.getKP(), imSize, pts3D, pts2D, threshold, proj, sqResiduals, inlierMask);
+}
+
 int GeometryUtils::filterMatches(const Matx33d &F, const vector<Point2d> &pts0, const vector<Point2d> &pts1, vector<uchar> &status, double distThreshold) {
-    
-    //compute epipolar lines
-    vector<Vec3d> epiLines0, epiLines1;
-    computeCorrespondEpilines(pts0, 1, F, epiLines1);
-    computeCorrespondEpilines(pts1, 2, F, epiLines0);
-    
-    //square threshold since we compute the square distance
-    double sqThreshold = distThreshold*distThreshold;
-    
     //check if the symmetric transfer error is too high for each point
-    float e01,e10;
-    int count = 0;
-    for (int i = 0; i < pts0.size(); i++) {
-        //compute distance from epilines
-        e01 = GeometryUtils::distancePointLine2D(pts0[i], epiLines0[i]);
-        e10 = GeometryUtils::distancePointLine2D(pts1[i], epiLines1[i]);
-        if (0.5*(e01+e10) >= sqThreshold) {
-            status.push_back(0);
-            count++;
-        }
-        else
-            status.push_back(1);
-    }
-    return count;
+    return filterMatchesStreaming(F, pts0, pts1, (const vector<Matx31d>*)NULL, status, distThreshold);
 }
 
 int GeometryUtils::filterMatches(const Matx33f &F, const vector<Point2f> &pts0, const vector<Point2f> &pts1, vector<uchar> &status, double distThreshold) {
-    
-    //compute epipolar lines
-    vector<Vec3f> epiLines0, epiLines1;
-    computeCorrespondEpilines(pts0, 1, F, epiLines1);
-    computeCorrespondEpilines(pts1, 2, F, epiLines0);
-    
-    //square threshold since we compute the square distance
-    double sqThreshold = distThreshold*distThreshold;
-    
     //check if the symmetric transfer error is too high for each point
-    float e01,e10;
-    int count = 0;
-    for (int i = 0; i < pts0.size(); i++) {
-        //compute distance from epilines
-        e01 = GeometryUtils::distancePointLine2D(pts0[i], epiLines0[i]);
-        e10 = GeometryUtils::distancePointLine2D(pts1[i], epiLines1[i]);
-        if (0.5*(e01+e10) >= sqThreshold) {
-            status.push_back(0);
-            count++;
-        }
-        else {
-            status.push_back(1);
-        }
-    }
-    return count;
+    return filterMatchesStreaming(F, pts0, pts1, (const vector<Matx31d>*)NULL, status, distThreshold);
 }
 
 int GeometryUtils::filterMatches(const Matx33f &F, const vector<Point2f> &pts0, const vector<Point2f> &pts1, vector<Matx31d> &pts3D, vector<uchar> &status, double distThreshold) {
-    
-    //compute epipolar lines
-    vector<Vec3f> epiLines0, epiLines1;
-    computeCorrespondEpilines(pts0, 1, F, epiLines1);
-    computeCorrespondEpilines(pts1, 2, F, epiLines0);
-    
-    //square threshold since we compute the square distance
-    double sqThreshold = distThreshold*distThreshold;
-    
-    //check if the symmetric transfer error is too high for each point
-    float e01,e10;
-    int count = 0;
-    for (int i = 0; i < pts0.size(); i++) {
-        //compute distance from epilines
-        e01 = GeometryUtils::distancePointLine2D(pts0[i], epiLines0[i]);
-        e10 = GeometryUtils::distancePointLine2D(pts1[i], epiLines1[i]);
-        if ((0.5*(e01+e10) >= sqThreshold) || (pts3D[i](2) <= 1.0)) { //check also that point is in front of the camera
-            status.push_back(0);
-            count++;
-        }
-        else {
-            status.push_back(1);
-        }
-    }
-    return count;
+    //check if the symmetric transfer error is too high for each point and that it is in front of the camera
+    return filterMatchesStreaming(F, pts0, pts1, &pts3D, status, distThreshold);
 }
 
-
 int GeometryUtils::filterMatches(const Matx33d &F, const vector<Point2d> &pts0, const vector<Point2d> &pts1, vector<Matx31d> &pts3D, vector<uchar> &status, double distThreshold) {
-    
-    //compute epipolar lines
-    vector<Vec3d> epiLines0, epiLines1;
-    Matx33f Fhat = F;
-    computeCorrespondEpilines(pts0, 1, F, epiLines1);
-    computeCorrespondEpilines(pts1, 2, F, epiLines0);
-    
-    //square threshold since we compute the square distance
-    double sqThreshold = distThreshold*distThreshold;
-    
-    //check if the symmetric transfer error is too high for each point
-    float e01,e10;
-    int count = 0;
-    for (int i = 0; i < pts0.size(); i++) {
-        //compute distance from epilines
-        e01 = GeometryUtils::distancePointLine2D(pts0[i], epiLines0[i]);
-        e10 = GeometryUtils::distancePointLine2D(pts1[i], epiLines1[i]);
-        if ((0.5*(e01+e10) >= sqThreshold) || (pts3D[i](2) <= 1.0)) { //check also that point is in front of the camera
-            status.push_back(0);
-            count++;
-        }
-        else {
-            status.push_back(1);
-        }
-    }
-    return count;
+    //check if the symmetric transfer error is too high for each point and that it is in front of the camera
+    return filterMatchesStreaming(F, pts0, pts1, &pts3D, status, distThreshold);
 }
@@ -24,7 +24,12 @@
 #define GeometryUtils_hpp
 
 #include <stdio.h>
+#include <float.h>
 #include <opencv2/opencv.hpp>
+#include "ParallelUtils.hpp"
+#include "CameraModel.hpp"
+#include "PointCloud3.hpp"
+#include "TrackTable.hpp"
 
 using namespace std;
 using namespace cv;
@@ -32,22 +37,67 @@ using namespace cv;
 class GeometryUtils {
     
 public:
+    //epipolar distance measures
+    enum EpipolarDistance {
+        EPIPOLAR_SYMMETRIC = 0,  //sum of the squared distances of both points from their epipolar lines
+        EPIPOLAR_SAMPSON = 1     //squared Sampson distance
+    };
+    
     //triangulation
     static void triangulatePoints(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0, const Matx33d &K1, const vector<Point2d> &f0, const vector<Point2d> &f1, vector<Matx31d> &outPts);
     static void triangulatePoints(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0, const Matx33d &K1, const vector<Point2f> &f0, const vector<Point2f> &f1, vector<Matx31d> &outPts);
+    //parallel triangulation over nThreads threads or a user supplied executor. Points are split into fixed chunks written
+    //to preallocated slots, so the output is bit-identical to the serial overloads whatever the number of threads
+    static void triangulatePoints(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0, const Matx33d &K1, const vector<Point2d> &f0, const vector<Point2d> &f1, vector<Matx31d> &outPts, int nThreads);
+    static void triangulatePoints(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0, const Matx33d &K1, const vector<Point2f> &f0, const vector<Point2f> &f1, vector<Matx31d> &outPts, int nThreads);
+    static void triangulatePoints(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0, const Matx33d &K1, const vector<Point2d> &f0, const vector<Point2d> &f1, vector<Matx31d> &outPts, const ParallelUtils::Executor &executor);
+    static void triangulatePoints(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0, const Matx33d &K1, const vector<Point2f> &f0, const vector<Point2f> &f1, vector<Matx31d> &outPts, const ParallelUtils::Executor &executor);
+    //triangulation with cameras caching their inverse intrinsics (serial if nThreads <= 1)
+    static void triangulatePoints(const CameraModel &cam0, const CameraModel &cam1, const vector<Point2d> &f0, const vector<Point2d> &f1, vector<Matx31d> &outPts, int nThreads = 1);
+    static void triangulatePoints(const CameraModel &cam0, const CameraModel &cam1, const vector<Point2f> &f0, const vector<Point2f> &f1, vector<Matx31d> &outPts, int nThreads = 1);
+    //triangulation appended to a structure-of-arrays point cloud
+    static void triangulatePoints(const CameraModel &cam0, const CameraModel &cam1, const vector<Point2d> &f0, const vector<Point2d> &f1, PointCloud3 &outPts, int nThreads = 1);
+    static void triangulatePoints(const CameraModel &cam0, const CameraModel &cam1, const vector<Point2f> &f0, const vector<Point2f> &f1, PointCloud3 &outPts, int nThreads = 1);
+    //batch triangulation of n correspondences stored as contiguous coordinate arrays (x0[i],y0[i]) <-> (x1[i],y1[i]).
+    //Solves the weighted 3x3 normal equations in closed form; agrees with the SVD least squares solution of the
+    //4x3 system to ~1e-9 relative for well conditioned pairs (the normal equations square the condition number,
+    //so near zero-parallax points can differ by up to ~1e-6 relative). X, Y, Z must hold n values each.
+    static void triangulatePointsBatch(const Matx34d &P0, const Matx34d &P1, const Matx33d &K0, const Matx33d &K1, const double *x0, const double *y0, const double *x1, const double *y1, size_t n, double *X, double *Y, double *Z, int iter = 10);
+    //N-view triangulation of every track of tracks, whose view indices refer to cams, appended to outPts. Each track solves the
+    //iteratively reweighted linear system stacked over all its observations through 3x3 normal equations on the stack, so tracks
+    //can be of any length, and tracks are split over nThreads threads. In the same pass reprojErrors, if given, receives the RMS
+    //reprojection error of each track in pixels and angles the largest angle between two of its viewing rays in degrees (each
+    //appended at its own end, so they need not be parallel to outPts). Tracks with fewer than two observations give NaN points and errors and zero angles
+    static void triangulateTracks(const vector<CameraModel> &cams, const TrackTable &tracks, PointCloud3 &outPts, vector<double> *reprojErrors = NULL, vector<double> *angles = NULL, int nThreads = 1);
     
     //projection
     static void projectPoints(const Matx34d &P, const Matx33d& K, const vector<Matx31d> &pts3D, vector<Point2d> &pts2D, Size imSize = Size(0,0));
     static void projectPoints(const Matx34d &P, const Matx33d& K, const vector<Matx31d> &pts3D, vector<Point2i> &pts2D, Size imSize = Size(0,0));
     static void projectPoints(const Matx33d &R, const Matx31d& t, const Matx33d& K, const vector<Matx31d> &pts3D, vector<Point2d> &pts2D, Size imSize = Size(0,0));
+    //projection of a point cloud view (PointCloud3::view() or a vector<Matx31d>), appending the points inside the image if imSize is given
+    static void projectPoints(const CameraModel &cam, const PointCloud3::View &pts3D, vector<Point2d> &pts2D, Size imSize = Size(0,0));
     static Point2d projectPoint(const Matx33d &R, const Matx31d &t, const Matx33d &K, const Matx31d &pt3D);
     static Point2d projectPoint(const Matx34d &P, const Matx33d &K, const Matx31d &pt3D);
     static Point2d projectPoint(const Matx34d &P, const Matx33d &K, const double* pt3D);
     
     //matrix decomposition
-    static bool RtFromEssentialMatrix(const Matx33d &E, const Matx33d &K0, const Matx33d &K1, const vector<Point2d> &pts0, const vector<Point2d> &pts1, Matx33d &R, Vec3d &t);
-    static bool RtFromEssentialMatrix(const Matx33f &E, const Matx33f &K0, const Matx33f &K1, const vector<Point2f> &pts0, const vector<Point2f> &pts1, Matx33d &R, Vec3d &t);
-    static bool RtFromHomographyMatrix(const Matx33f &H, const Matx33f &K0, const Matx33f &K1, const vector<Point2f> &pts0, const vector<Point2f> &pts1, Matx33d &R, Vec3d &t);
+    //votes, if given, receives the cheirality votes of every candidate pose (see cheiralityVote). The pose with the most votes wins,
+    //the first one on ties in both precisions (the float overloads used to take the last), and is rejected if fewer than 85% of all
+    //the correspondences voted for it
+    static bool RtFromEssentialMatrix(const Matx33d &E, const Matx33d &K0, const Matx33d &K1, const vector<Point2d> &pts0, const vector<Point2d> &pts1, Matx33d &R, Vec3d &t, vector<int> *votes = NULL);
+    static bool RtFromEssentialMatrix(const Matx33f &E, const Matx33f &K0, const Matx33f &K1, const vector<Point2f> &pts0, const vector<Point2f> &pts1, Matx33d &R, Vec3d &t, vector<int> *votes = NULL);
+    static bool RtFromHomographyMatrix(const Matx33d &H, const Matx33d &K0, const Matx33d &K1, const vector<Point2d> &pts0, const vector<Point2d> &pts1, Matx33d &R, Vec3d &t, vector<int> *votes = NULL);
+    static bool RtFromHomographyMatrix(const Matx33f &H, const Matx33f &K0, const Matx33f &K1, const vector<Point2f> &pts0, const vector<Point2f> &pts1, Matx33d &R, Vec3d &t, vector<int> *votes = NULL);
+    
+    //cheirality voting between candidate poses P = [R|t] of view 1 (view 0 is [I|0]): a correspondence votes for a candidate if a single
+    //closed-form triangulation puts it in front of view 0 (z > minDepth). Counting stops as soon as the leading candidate cannot be caught
+    //any more, and if maxPoints > 0 only a deterministic random subset of maxPoints correspondences (drawn with seed) is used.
+    //Returns the index of the winning candidate (the first one on ties, -1 if no votes) and fills the votes per candidate and the number of correspondences counted
+    static int cheiralityVote(const vector<Matx34d> &candidates, const Matx33d &K0, const Matx33d &K1, const vector<Point2d> &pts0, const vector<Point2d> &pts1, vector<int> &votes, int &nEvaluated, int maxPoints = 0, double minDepth = 1.0, uint64 seed = 0x5eed);
+    static int cheiralityVote(const vector<Matx34d> &candidates, const Matx33d &K0, const Matx33d &K1, const vector<Point2f> &pts0, const vector<Point2f> &pts1, vector<int> &votes, int &nEvaluated, int maxPoints = 0, double minDepth = 1.0, uint64 seed = 0x5eed);
+    //five-point essential matrix (Nister) from exactly 5 correspondences in coordinates normalised with K0.inv()/K1.inv(). Writes the
+    //up to 10 real solutions of x1^T*E*x0 = 0, with unit Frobenius norm, to E without allocating and returns their number
+    static int essentialFromFivePoints(const Point2d *pts0, const Point2d *pts1, Matx33d *E);
     static void calculateFundamentalMatrix(const Matx33d &K0, const Matx33d &R0, const Matx31d &t0, const Matx33d &K1, const Matx33d &R1, const Matx31d &t1, Matx33d &F);
     static Matx33d getSkewSymmetric(const Matx31d &v);
     
@@ -56,10 +106,33 @@ public:
     static double calculateHomographyAvgError(const vector<Point2d> &pts0, const vector<Point2d> &pts1, const Matx33d &H);
     static float calculateFundamentalAvgError(const vector<Point2f> &pts0, const vector<Point2f> &pts1, const Matx33f &F);
     static float calculateHomographyAvgError(const vector<Point2f> &pts0, const vector<Point2f> &pts1, const Matx33f &H);
+    //streaming epipolar residuals of n correspondences: F*x0 and F^T*x1 are computed on the fly in register-wide batches and the residuals
+    //(see EpipolarDistance) written to caller buffers without allocating. residuals and status may be NULL; status[i] is 1 if
+    //residuals[i] < maxResidual. Returns the number of residuals >= maxResidual
+    static int epipolarResiduals(const Matx33d &F, const Point2d *pts0, const Point2d *pts1, size_t n, double *residuals, uchar *status = NULL, double maxResidual = DBL_MAX, int type = EPIPOLAR_SYMMETRIC);
+    static int epipolarResiduals(const Matx33f &F, const Point2f *pts0, const Point2f *pts1, size_t n, float *residuals, uchar *status = NULL, float maxResidual = FLT_MAX, int type = EPIPOLAR_SYMMETRIC);
+    //streaming symmetric transfer error of n correspondences (sum of the squared forward and backward transfer distances), without allocating
+    static void homographyResiduals(const Matx33d &H, const Point2d *pts0, const Point2d *pts1, size_t n, double *residuals);
+    static void homographyResiduals(const Matx33f &H, const Point2f *pts0, const Point2f *pts1, size_t n, float *residuals);
     
     //filtering outliers
     static int filterOutliers(const Matx34d &P, const Matx33d &K, const Size &imSize, const vector<Matx31d> &pts3D, const vector<Point2f> &pts2D, vector<uchar> &status, double threshold = 3.0);
     static int filterOutliers(const Matx34d &P, const Matx33d &K, const Size &imSize, const vector<Matx31d> &pts3D, const vector<Point2d> &pts2D, vector<uchar> &status, double threshold = 3.0);
+    //fused projection and outlier test in one pass over n points stored contiguously as x,y,z triples (e.g. &pts3D[0].val[0]).
+    //Writes the projections, the squared residuals to the observations and a packed inlier mask (bit i%64 of inlierMask[i/64],
+    //(n+63)/64 words) to caller buffers without allocating; proj and sqResiduals may be NULL. Returns the number of outliers
+    static int projectAndFilter(const Matx34d &P, const Matx33d &K, const Size &imSize, const double *pts3D, const Point2f *pts2D, size_t n, double threshold, Point2d *proj, double *sqResiduals, uint64 *inlierMask);
+    static int projectAndFilter(const Matx34d &P, const Matx33d &K, const Size &imSize, const double *pts3D, const Point2d *pts2D, size_t n, double threshold, Point2d *proj, double *sqResiduals, uint64 *inlierMask);
+    //same as above with the projection matrix K*P cached by cam
+    static int filterOutliers(const CameraModel &cam, const Size &imSize, const vector<Matx31d> &pts3D, const vector<Point2f> &pts2D, vector<uchar> &status, double threshold = 3.0);
+    static int filterOutliers(const CameraModel &cam, const Size &imSize, const vector<Matx31d> &pts3D, const vector<Point2d> &pts2D, vector<uchar> &status, double threshold = 3.0);
+    static int projectAndFilter(const CameraModel &cam, const Size &imSize, const double *pts3D, const Point2f *pts2D, size_t n, double threshold, Point2d *proj, double *sqResiduals, uint64 *inlierMask);
+    static int projectAndFilter(const CameraModel &cam, const Size &imSize, const double *pts3D, const Point2d *pts2D, size_t n, double threshold, Point2d *proj, double *sqResiduals, uint64 *inlierMask);
+    //same as above on a point cloud view, n being the size of the view
+    static int filterOutliers(const CameraModel &cam, const Size &imSize, const PointCloud3::View &pts3D, const vector<Point2f> &pts2D, vector<uchar> &status, double threshold = 3.0);
+    static int filterOutliers(const CameraModel &cam, const Size &imSize, const PointCloud3::View &pts3D, const vector<Point2d> &pts2D, vector<uchar> &status, double threshold = 3.0);
+    static int projectAndFilter(const CameraModel &cam, const Size &imSize, const PointCloud3::View &pts3D, const Point2f *pts2D, double threshold, Point2d *proj, double *sqResiduals, uint64 *inlierMask);
+    static int projectAndFilter(const CameraModel &cam, const Size &imSize, const PointCloud3::View &pts3D, const Point2d *pts2D, double threshold, Point2d *proj, double *sqResiduals, uint64 *inlierMask);
     static int filterMatches(const Matx33d &F, const vector<Point2d> &pts0, const vector<Point2d> &pts1, vector<uchar> &status, double distThreshold);
     static int filterMatches(const Matx33f &F, const vector<Point2f> &pts0, const vector<Point2f> &pts1, vector<uchar> &status, double distThreshold);
     static int filterMatches(const Matx33f &F, const vector<Point2f> &pts0, const vector<Point2f> &pts1, vector<Matx31d> &pts3D, vector<uchar> &status, double distThreshold);
@@ -70,7 +143,9 @@ public:
     
 private:
     
-    static Matx31d linearTriangulation(const Matx34d &P0, const Matx34d &P1, const Point3d pt0, const Point3d pt1, int iter = 10);//
+    //triangulation of one correspondence in normalised coordinates, read in the precision it is given in
+    static Matx31d linearTriangulation(const Matx34d &P0, const Matx34d &P1, const Point2d &pt0, const Point2d &pt1, int iter = 10);
+    static Matx31d linearTriangulation(const Matx34d &P0, const Matx34d &P1, const Point2f &pt0, const Point2f &pt1, int iter = 10);
 };
 
 #endif /* GeometryUtils_hpp */
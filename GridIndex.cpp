@@ -0,0 +1,224 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#include "GridIndex.hpp"
+
+//largest k whose squared distances are kept on the stack by knnSearch when the caller does not want them
+static const int kStackNeighbours = 64;
+
+GridIndex::GridIndex(Size imSize, int cellSize) {
+    reset(imSize, cellSize);
+}
+
+void GridIndex::reset(Size imSize, int cellSize) {
+    this->imSize = imSize;
+    cell = max(cellSize, 1);
+    invCell = 1.0/cell;
+    cols = max((imSize.width + cell - 1)/cell, 1);
+    rows = max((imSize.height + cell - 1)/cell, 1);
+    cellStart.assign(cols*rows + 1, 0);
+    idx.clear();
+    xs.clear();
+    ys.clear();
+}
+
+template <typename T>
+void GridIndex::buildImpl(const Point_<T> *pts, size_t n) {
+    
+    //counting sort of the points by cell, stable so every cell keeps the input order
+    double width = imSize.width, height = imSize.height;
+    pointCell.resize(n);
+    cellStart.assign(cols*rows + 1, 0);
+    for (size_t i = 0; i < n; i++) {
+        double x = pts[i].x, y = pts[i].y;
+        bool inside = (x >= 0) && (x < width) && (y >= 0) && (y < height);
+        int c = inside ? min((int)(y*invCell), rows - 1)*cols + min((int)(x*invCell), cols - 1) : -1;
+        pointCell[i] = c;
+        cellStart[c + 1] += inside;
+    }
+    for (int c = 1; c <= cols*rows; c++)
+        cellStart[c] += cellStart[c - 1];
+    
+    //filling advances each start to the next cell's, shifted back afterwards
+    size_t m = cellStart.back();
+    idx.resize(m);
+    xs.resize(m);
+    ys.resize(m);
+    for (size_t i = 0; i < n; i++) {
+        int c = pointCell[i];
+        if (c < 0)
+            continue;
+        int k = cellStart[c]++;
+        idx[k] = (int)i;
+        xs[k] = pts[i].x;
+        ys[k] = pts[i].y;
+    }
+    for (int c = cols*rows; c > 0; c--)
+        cellStart[c] = cellStart[c - 1];
+    cellStart[0] = 0;
+}
+
+void GridIndex::build(const vector<Point2d> &pts) {
+    buildImpl(pts.data(), pts.size());
+}
+
+void GridIndex::build(const vector<Point2f> &pts) {
+    buildImpl(pts.data(), pts.size());
+}
+
+void GridIndex::build(const CameraModel &cam, const PointCloud3::View &pts3D) {
+    
+    //points behind the camera get NaN projections so that they are left out
+    const Matx34d &KP = cam.getKP();
+    size_t n = pts3D.size();
+    projected.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        size_t j = i*pts3D.stride;
+        double x = pts3D.x[j], y = pts3D.y[j], z = pts3D.z[j];
+        double pz = KP(2,0)*x + KP(2,1)*y + KP(2,2)*z + KP(2,3);
+        double iz = (pz > 0) ? 1.0/pz : NAN;
+        projected[i] = Point2d((KP(0,0)*x + KP(0,1)*y + KP(0,2)*z + KP(0,3))*iz, (KP(1,0)*x + KP(1,1)*y + KP(1,2)*z + KP(1,3))*iz);
+    }
+    buildImpl(projected.data(), n);
+}
+
+bool GridIndex::cellRange(const Point2d &centre, double r, int &cx0, int &cy0, int &cx1, int &cy1) const {
+    
+    if (!(r >= 0) || !(centre.x + r >= 0) || !(centre.y + r >= 0) || !(centre.x - r < imSize.width) || !(centre.y - r < imSize.height))
+        return false;
+    cx0 = (int)max((centre.x - r)*invCell, 0.0);
+    cy0 = (int)max((centre.y - r)*invCell, 0.0);
+    cx1 = (int)min((centre.x + r)*invCell, (double)(cols - 1));
+    cy1 = (int)min((centre.y + r)*invCell, (double)(rows - 1));
+    return true;
+}
+
+int GridIndex::radiusSearch(const Point2d &centre, double radius, vector<int> &indices, vector<double> *sqDists) const {
+    
+    indices.clear();
+    if (sqDists)
+        sqDists->clear();
+    int cx0, cy0, cx1, cy1;
+    if (!cellRange(centre, radius, cx0, cy0, cx1, cy1))
+        return 0;
+    
+    //the cells of a row of the range are contiguous in the flat arrays
+    double r2 = radius*radius;
+    for (int cy = cy0; cy <= cy1; cy++) {
+        int end = cellStart[cy*cols + cx1 + 1];
+        for (int k = cellStart[cy*cols + cx0]; k < end; k++) {
+            double dx = xs[k] - centre.x, dy = ys[k] - centre.y, d2 = dx*dx + dy*dy;
+            if (d2 > r2)
+                continue;
+            indices.push_back(idx[k]);
+            if (sqDists)
+                sqDists->push_back(d2);
+        }
+    }
+    return (int)indices.size();
+}
+
+int GridIndex::radiusCount(const Point2d &centre, double radius) const {
+    
+    int cx0, cy0, cx1, cy1;
+    if (!cellRange(centre, radius, cx0, cy0, cx1, cy1))
+        return 0;
+    
+    double r2 = radius*radius;
+    int count = 0;
+    for (int cy = cy0; cy <= cy1; cy++) {
+        int end = cellStart[cy*cols + cx1 + 1];
+        for (int k = cellStart[cy*cols + cx0]; k < end; k++) {
+            double dx = xs[k] - centre.x, dy = ys[k] - centre.y;
+            count += dx*dx + dy*dy <= r2;
+        }
+    }
+    return count;
+}
+
+int GridIndex::knnSearch(const Point2d &centre, int k, vector<int> &indices, vector<double> *sqDists, double maxRadius) const {
+    
+    indices.clear();
+    if (sqDists)
+        sqDists->clear();
+    if ((k <= 0) || idx.empty() || !(centre.x == centre.x) || !(centre.y == centre.y))
+        return 0;
+    
+    //sorted candidates, their squared distances on the stack unless the caller wants them
+    double stackDists[kStackNeighbours];
+    vector<double> heapDists;
+    double *dists = stackDists;
+    if (sqDists) {
+        sqDists->resize(k);
+        dists = &(*sqDists)[0];
+    }
+    else if (k > kStackNeighbours) {
+        heapDists.resize(k);
+        dists = &heapDists[0];
+    }
+    indices.resize(k);
+    
+    //cell of the centre (clamped to the grid) and its distance to the border of that cell, a lower bound on the distance to the
+    //cells of ring r being (r - 1)*cell + margin
+    int cx = (int)min(max(centre.x*invCell, 0.0), (double)(cols - 1));
+    int cy = (int)min(max(centre.y*invCell, 0.0), (double)(rows - 1));
+    double margin = min(min(centre.x - cx*cell, (cx + 1)*cell - centre.x), min(centre.y - cy*cell, (cy + 1)*cell - centre.y));
+    margin = max(margin, 0.0);
+    double maxR2 = (maxRadius < DBL_MAX) ? maxRadius*maxRadius : DBL_MAX;
+    int count = 0, maxRing = max(max(cx, cols - 1 - cx), max(cy, rows - 1 - cy));
+    for (int r = 0; r <= maxRing; r++) {
+        double bound = max(r - 1, 0)*cell + ((r > 0) ? margin : 0);
+        double bound2 = bound*bound;
+        if ((bound2 > maxR2) || ((count == k) && (bound2 > dists[k - 1])))
+            break;
+        
+        //cells at Chebyshev distance r from the centre cell
+        for (int y = max(cy - r, 0); y <= min(cy + r, rows - 1); y++) {
+            bool edge = (y == cy - r) || (y == cy + r);
+            int step = edge ? 1 : 2*r;
+            for (int x = cx - r; x <= cx + r; x += max(step, 1)) {
+                if ((x < 0) || (x >= cols))
+                    continue;
+                int c = y*cols + x;
+                for (int p = cellStart[c]; p < cellStart[c + 1]; p++) {
+                    double dx = xs[p] - centre.x, dy = ys[p] - centre.y, d2 = dx*dx + dy*dy;
+                    if ((d2 > maxR2) || ((count == k) && (d2 >= dists[k - 1])))
+                        continue;
+                    
+                    //insertion into the sorted candidates
+                    int j = (count < k) ? count++ : k - 1;
+                    for (; (j > 0) && (dists[j - 1] > d2); j--) {
+                        dists[j] = dists[j - 1];
+                        indices[j] = indices[j - 1];
+                    }
+                    dists[j] = d2;
+                    indices[j] = idx[p];
+                }
+            }
+        }
+    }
+    
+    indices.resize(count);
+    if (sqDists)
+        sqDists->resize(count);
+    return count;
+}
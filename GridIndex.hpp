@@ -0,0 +1,97 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef GridIndex_hpp
+#define GridIndex_hpp
+
+#include <stdio.h>
+#include <float.h>
+#include <opencv2/opencv.hpp>
+#include "CameraModel.hpp"
+#include "PointCloud3.hpp"
+
+using namespace std;
+using namespace cv;
+
+//Bucketed 2D grid over an image for neighbourhood queries on projected points. Points are counting sorted into square cells, and
+//the index of every point and its coordinates are stored cell after cell in flat arrays next to the cell offsets, so a query only
+//reads the few cells it overlaps and their points contiguously. Rebuilding for the next frame reuses the arrays
+class GridIndex {
+    
+public:
+    
+    //grid of cellSize pixel cells covering an image of imSize. Cells about the size of the usual query radius, or holding a few
+    //points each, work best: sparse grids of small cells make knnSearch walk many empty cells
+    GridIndex(Size imSize = Size(0,0), int cellSize = 16);
+    
+    //resizes the grid, keeping its memory; the index is empty until the next build
+    void reset(Size imSize, int cellSize = 16);
+    
+    Size imageSize() const { return imSize; }
+    int cellSize() const { return cell; }
+    
+    //number of indexed points
+    size_t size() const { return idx.size(); }
+    
+    //indexes pts (e.g. the output of GeometryUtils::projectPoints without imSize), point i keeping index i. Points outside the
+    //image are left out
+    void build(const vector<Point2d> &pts);
+    void build(const vector<Point2f> &pts);
+    
+    //projects pts3D with cam and indexes the points in front of the camera that fall inside the image, point i keeping index i
+    void build(const CameraModel &cam, const PointCloud3::View &pts3D);
+    
+    //indices of the points within radius pixels of centre, and their squared distances if sqDists is given, in no particular
+    //order. Returns their number
+    int radiusSearch(const Point2d &centre, double radius, vector<int> &indices, vector<double> *sqDists = NULL) const;
+    
+    //number of points within radius pixels of centre
+    int radiusCount(const Point2d &centre, double radius) const;
+    
+    //indices of the (up to) k points nearest to centre within maxRadius pixels, nearest first, and their squared distances if
+    //sqDists is given. Cells are searched in rings of growing distance until none can hold a closer point. Returns their number
+    int knnSearch(const Point2d &centre, int k, vector<int> &indices, vector<double> *sqDists = NULL, double maxRadius = DBL_MAX) const;
+    
+private:
+    
+    Size imSize;
+    int cell, cols, rows;
+    double invCell;
+    
+    //points of cell c are [cellStart[c], cellStart[c+1]) of idx, xs and ys
+    vector<int> cellStart;
+    vector<int> idx;
+    vector<double> xs, ys;
+    
+    //cell of every input point (-1 if left out) and projections, kept between builds
+    vector<int> pointCell;
+    vector<Point2d> projected;
+    
+    //points outside the image (or with NaN coordinates) are left out
+    template <typename T>
+    void buildImpl(const Point_<T> *pts, size_t n);
+    
+    //range of cells overlapped by the square of half side r around centre, false if it misses the grid
+    bool cellRange(const Point2d &centre, double r, int &cx0, int &cy0, int &cx1, int &cy1) const;
+};
+
+#endif /* GridIndex_hpp */
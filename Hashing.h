@@ -23,56 +23,112 @@
 #ifndef Hashing_h
 #define Hashing_h
 
+#include <stdint.h>
+#include <string.h>
+#include <functional>
 #include <tuple>
-namespace std{
-    namespace
-    {
-        
-        // Code from boost
-        // Reciprocal of the golden ratio helps spread entropy
-        //     and handles duplicates.
-        // See Mike Seymour in magic-numbers-in-boosthash-combine:
-        //     http://stackoverflow.com/questions/4948780
-        
-        template <class T>
-        inline void hash_combine(std::size_t& seed, T const& v)
-        {
-            seed ^= hash<T>()(v) + 0x9e3779b9 + (seed<<6) + (seed>>2);
+#include <type_traits>
+
+//64-bit mixers for TupleHash. mix maps a word to a well distributed hash, so that nearby integers (std::hash<int> is the identity)
+//land in unrelated buckets
+
+//finalizer of SplitMix64 (Stafford's Mix13 variant), shifts and multiplies only
+struct SplitMix64 {
+    static inline uint64_t mix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27))*0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+};
+
+//wyhash style mixer: the 128-bit product of the word and a constant, folded onto 64 bits
+struct WyMix {
+    static inline uint64_t mum(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+        __uint128_t r = (__uint128_t)a*b;
+        return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+        uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b;
+        uint64_t rh = ha*hb, rm0 = ha*lb, rm1 = hb*la, rl = la*lb, t = rl + (rm0 << 32), c = t < rl;
+        uint64_t lo = t + (rm1 << 32);
+        c += lo < t;
+        uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+        return lo ^ hi;
+#endif
+    }
+    static inline uint64_t mix(uint64_t x) {
+        return mum(x ^ 0xa0761d6478bd642full, 0xe7037ed1a0b428dbull);
+    }
+};
+
+//Hash of tuples (and pairs) for unordered containers, e.g. unordered_map<tuple<int,int,int>, V, TupleHash<> >, which does not rely
+//on the std::hash specialization below. Every element is turned into a 64-bit word (integers and enums by value, floating point by
+//bits, with -0.0 as 0.0, anything else through std::hash) and folded in with h = Mixer::mix(h ^ word), starting from Seed
+template <class Mixer = WyMix, uint64_t Seed = 0x243f6a8885a308d3ull>
+struct TupleHash {
+    
+    template <typename T>
+    static inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, uint64_t>::type word(const T &v) {
+        return (uint64_t)v;
+    }
+    
+    template <typename T>
+    static inline typename std::enable_if<std::is_floating_point<T>::value, uint64_t>::type word(const T &v) {
+        //-0.0 == 0.0, so both must hash the same
+        if (v == 0)
+            return 0;
+        uint64_t w = 0;
+        memcpy(&w, &v, sizeof(T) < sizeof(w) ? sizeof(T) : sizeof(w));
+        return w;
+    }
+    
+    template <typename T>
+    static inline typename std::enable_if<!std::is_arithmetic<T>::value && !std::is_enum<T>::value, uint64_t>::type word(const T &v) {
+        return (uint64_t)std::hash<T>()(v);
+    }
+    
+    //recursion over the elements of a tuple
+    template <class Tuple, size_t Index = std::tuple_size<Tuple>::value>
+    struct Fold {
+        static inline uint64_t apply(uint64_t h, const Tuple &t) {
+            return Mixer::mix(Fold<Tuple, Index - 1>::apply(h, t) ^ word(std::get<Index - 1>(t)));
         }
-        
-        // Recursive template code derived from Matthieu M.
-        template <class Tuple, size_t Index = std::tuple_size<Tuple>::value - 1>
-        struct HashValueImpl
-        {
-            static void apply(size_t& seed, Tuple const& tuple)
-            {
-                HashValueImpl<Tuple, Index-1>::apply(seed, tuple);
-                hash_combine(seed, get<Index>(tuple));
-            }
-        };
-        
-        template <class Tuple>
-        struct HashValueImpl<Tuple,0>
-        {
-            static void apply(size_t& seed, Tuple const& tuple)
-            {
-                hash_combine(seed, get<0>(tuple));
-            }
-        };
+    };
+    
+    template <class Tuple>
+    struct Fold<Tuple, 0> {
+        static inline uint64_t apply(uint64_t h, const Tuple &) {
+            return h;
+        }
+    };
+    
+    template <typename... TT>
+    size_t operator()(const std::tuple<TT...> &t) const {
+        return (size_t)Fold<std::tuple<TT...> >::apply(Seed, t);
     }
     
+    template <typename T1, typename T2>
+    size_t operator()(const std::pair<T1, T2> &p) const {
+        return (size_t)Mixer::mix(Mixer::mix(Seed ^ word(p.first)) ^ word(p.second));
+    }
+};
+
+//std::hash of tuples through TupleHash, so unordered containers keyed on tuples work with the default hasher. Define
+//CVUTILS_NO_STD_TUPLE_HASH to keep this out of namespace std (and use TupleHash explicitly)
+#ifndef CVUTILS_NO_STD_TUPLE_HASH
+namespace std{
     template <typename ... TT>
     struct hash<std::tuple<TT...>>
     {
         size_t
         operator()(std::tuple<TT...> const& tt) const
         {
-            size_t seed = 0;
-            HashValueImpl<std::tuple<TT...> >::apply(seed, tt);
-            return seed;
+            return TupleHash<>()(tt);
         }
         
     };
 }
+#endif
 
 #endif /* Hashing_h */
@@ -0,0 +1,218 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#include "MathUtils.hpp"
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+using namespace std;
+
+double MathUtils::polynomialEval(const double *coeffs, int degree, double x) {
+    double v = coeffs[degree];
+    for (int i = degree - 1; i >= 0; i--)
+        v = v*x + coeffs[i];
+    return v;
+}
+
+//Sturm sequence of a polynomial, stored with one row per polynomial
+struct SturmSequence {
+    double s[MathUtils::maxPolynomialDegree + 1][MathUtils::maxPolynomialDegree + 1];
+    int deg[MathUtils::maxPolynomialDegree + 1];
+    int n;
+    
+    //number of sign changes of the sequence at x
+    int signChanges(double x) const {
+        int changes = 0;
+        double last = 0;
+        for (int i = 0; i < n; i++) {
+            double v = MathUtils::polynomialEval(s[i], deg[i], x);
+            if (v != 0) {
+                if (last*v < 0)
+                    changes++;
+                last = v;
+            }
+        }
+        return changes;
+    }
+    
+    //number of sign changes at +infinity (positive) or -infinity (negative)
+    int signChangesAtInfinity(bool positive) const {
+        int changes = 0;
+        double last = 0;
+        for (int i = 0; i < n; i++) {
+            double v = s[i][deg[i]];
+            if (!positive && (deg[i] % 2))
+                v = -v;
+            if (v != 0) {
+                if (last*v < 0)
+                    changes++;
+                last = v;
+            }
+        }
+        return changes;
+    }
+};
+
+//builds the Sturm sequence of the monic polynomial p, stopping at the gcd of p and p'
+static void buildSturmSequence(const double *p, int degree, SturmSequence &seq) {
+    
+    seq.n = 2;
+    seq.deg[0] = degree;
+    seq.deg[1] = degree - 1;
+    for (int i = 0; i <= degree; i++)
+        seq.s[0][i] = p[i];
+    for (int i = 0; i < degree; i++)
+        seq.s[1][i] = (i + 1)*p[i + 1]/degree;
+    
+    while (seq.deg[seq.n - 1] > 0) {
+        const double *a = seq.s[seq.n - 2], *b = seq.s[seq.n - 1];
+        int da = seq.deg[seq.n - 2], db = seq.deg[seq.n - 1];
+        
+        //remainder of a/b
+        double r[MathUtils::maxPolynomialDegree + 1];
+        for (int i = 0; i <= da; i++)
+            r[i] = a[i];
+        for (int i = da; i >= db; i--) {
+            double q = r[i]/b[db];
+            for (int j = 0; j <= db; j++)
+                r[i - db + j] -= q*b[j];
+        }
+        
+        //drop vanishing leading terms, stop if p and p' share a factor
+        double scale = 0;
+        for (int i = 0; i < db; i++)
+            scale = max(scale, fabs(r[i]));
+        int dr = db - 1;
+        while ((dr >= 0) && (fabs(r[dr]) <= 1e-12*scale))
+            dr--;
+        if ((dr < 0) || (scale == 0))
+            break;
+        
+        //next element is -r, scaled by a positive factor to keep the coefficients in range
+        double *next = seq.s[seq.n];
+        for (int i = 0; i <= dr; i++)
+            next[i] = -r[i]/scale;
+        seq.deg[seq.n] = dr;
+        seq.n++;
+    }
+}
+
+int MathUtils::polynomialRealRoots(const double *coeffs, int degree, double *roots) {
+    
+    //drop vanishing leading coefficients
+    double maxCoeff = 0;
+    for (int i = 0; i <= degree; i++)
+        maxCoeff = max(maxCoeff, fabs(coeffs[i]));
+    while ((degree > 0) && (fabs(coeffs[degree]) <= 1e-14*maxCoeff))
+        degree--;
+    if ((degree <= 0) || (degree > maxPolynomialDegree))
+        return 0;
+    
+    //monic polynomial and Fujiwara bound on the roots
+    double p[maxPolynomialDegree + 1];
+    double bound = 0;
+    for (int i = 0; i <= degree; i++)
+        p[i] = coeffs[i]/coeffs[degree];
+    for (int i = 1; i <= degree; i++) {
+        double a = fabs(p[degree - i]);
+        if (i == degree)
+            a *= 0.5;
+        bound = max(bound, pow(a, 1.0/i));
+    }
+    bound = 2*bound + DBL_MIN;
+    
+    SturmSequence seq;
+    buildSturmSequence(p, degree, seq);
+    
+    //isolate roots by bisection on the number of sign changes, the number of roots in (a,b] being V(a) - V(b)
+    struct Interval { double a, b; int va, vb; };
+    Interval stack[64*maxPolynomialDegree];
+    int nStack = 0, nRoots = 0;
+    stack[nStack++] = {-bound, bound, seq.signChangesAtInfinity(false), seq.signChangesAtInfinity(true)};
+    while (nStack > 0) {
+        Interval I = stack[--nStack];
+        int k = I.va - I.vb;
+        if (k <= 0)
+            continue;
+        
+        double width = I.b - I.a;
+        if ((k > 1) && (width > 1e-12*max(1.0, fabs(I.a))) && (nStack + 2 <= 64*maxPolynomialDegree)) {
+            double mid = 0.5*(I.a + I.b);
+            int vm = seq.signChanges(mid);
+            stack[nStack++] = {I.a, mid, I.va, vm};
+            stack[nStack++] = {mid, I.b, vm, I.vb};
+            continue;
+        }
+        if (k > 1) {
+            //cluster of roots that cannot be separated any more
+            roots[nRoots++] = 0.5*(I.a + I.b);
+            continue;
+        }
+        
+        //refine the single root in (a,b]
+        double a = I.a, b = I.b;
+        double fa = polynomialEval(p, degree, a), fb = polynomialEval(p, degree, b);
+        double x = 0.5*(a + b);
+        if (fb == 0)
+            x = b;
+        else if (fa*fb < 0) {
+            //Newton iterations, falling back to bisection when a step leaves the bracket or does not halve the previous one
+            double dxOld = b - a;
+            for (int it = 0; it < 100; it++) {
+                double f = polynomialEval(p, degree, x);
+                if (f == 0)
+                    break;
+                if (f*fa < 0)
+                    b = x;
+                else {
+                    a = x;
+                    fa = f;
+                }
+                double df = polynomialEval(seq.s[1], degree - 1, x)*degree;
+                double xn = (df != 0) ? x - f/df : a;
+                if ((xn <= a) || (xn >= b) || (fabs(xn - x) > 0.5*fabs(dxOld)))
+                    xn = 0.5*(a + b);
+                dxOld = xn - x;
+                x = xn;
+                if ((fabs(dxOld) <= 4*DBL_EPSILON*max(1.0, fabs(x))) || (b - a <= 4*DBL_EPSILON*max(1.0, fabs(x))))
+                    break;
+            }
+        }
+        else {
+            //root of even multiplicity, bisect on the sign changes
+            int va = I.va;
+            for (int it = 0; it < 100 && (b - a) > 4*DBL_EPSILON*max(1.0, fabs(a)); it++) {
+                double mid = 0.5*(a + b);
+                if (va - seq.signChanges(mid) > 0)
+                    b = mid;
+                else {
+                    a = mid;
+                    va = seq.signChanges(mid);
+                }
+            }
+            x = 0.5*(a + b);
+        }
+        roots[nRoots++] = x;
+    }
+    return nRoots;
+}
@@ -0,0 +1,43 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef MathUtils_hpp
+#define MathUtils_hpp
+
+#include <stdio.h>
+
+class MathUtils {
+    
+public:
+    
+    //highest polynomial degree handled by polynomialRealRoots
+    static const int maxPolynomialDegree = 16;
+    
+    //distinct real roots of sum_i coeffs[i]*x^i (coefficients in increasing degree) by Sturm sequence isolation and safeguarded
+    //Newton refinement, without allocating. roots must hold degree values; returns the number of roots found
+    static int polynomialRealRoots(const double *coeffs, int degree, double *roots);
+    
+    //evaluates sum_i coeffs[i]*x^i
+    static double polynomialEval(const double *coeffs, int degree, double x);
+};
+
+#endif /* MathUtils_hpp */
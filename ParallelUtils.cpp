@@ -0,0 +1,80 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#include "ParallelUtils.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+ParallelUtils::Executor ParallelUtils::threadExecutor(int nThreads) {
+    
+    return [nThreads](int nChunks, const function<void(int)> &job) {
+        
+        //chunks are handed out dynamically so slow chunks do not stall a whole thread
+        atomic<int> next(0);
+        auto worker = [&next, nChunks, &job]() {
+            for (int c = next++; c < nChunks; c = next++)
+                job(c);
+        };
+        
+        int nWorkers = min(max(nThreads, 1), nChunks);
+        vector<thread> threads;
+        threads.reserve(max(nWorkers - 1, 0));
+        for (int i = 1; i < nWorkers; i++)
+            threads.push_back(thread(worker));
+        worker();
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+    };
+}
+
+void ParallelUtils::parallelFor(size_t n, size_t chunkSize, const Executor &executor, const function<void(size_t, size_t)> &body, size_t align) {
+    
+    if (n == 0)
+        return;
+    
+    //round chunk size up to the alignment
+    align = max(align, (size_t)1);
+    chunkSize = max(chunkSize, (size_t)1);
+    chunkSize = ((chunkSize + align - 1)/align)*align;
+    int nChunks = (int)((n + chunkSize - 1)/chunkSize);
+    
+    if (nChunks == 1 || !executor) {
+        body(0, n);
+        return;
+    }
+    
+    executor(nChunks, [n, chunkSize, &body](int c) {
+        size_t begin = c*chunkSize;
+        body(begin, min(begin + chunkSize, n));
+    });
+}
+
+void ParallelUtils::parallelFor(size_t n, size_t chunkSize, int nThreads, const function<void(size_t, size_t)> &body, size_t align) {
+    
+    if (nThreads <= 1) {
+        body(0, n);
+        return;
+    }
+    parallelFor(n, chunkSize, threadExecutor(nThreads), body, align);
+}
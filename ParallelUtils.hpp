@@ -0,0 +1,47 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef ParallelUtils_hpp
+#define ParallelUtils_hpp
+
+#include <stdio.h>
+#include <functional>
+
+using namespace std;
+
+class ParallelUtils {
+    
+public:
+    
+    //runs job(c) exactly once for every chunk c in [0, nChunks), in any order and on any thread, and returns once all of them have finished
+    typedef function<void(int nChunks, const function<void(int)> &job)> Executor;
+    
+    //executor running the chunks on nThreads threads (the calling thread is one of them)
+    static Executor threadExecutor(int nThreads);
+    
+    //splits [0, n) into chunks of about chunkSize elements (a multiple of align) and runs body(begin, end) on each through the executor.
+    //Chunk boundaries do not depend on the executor, so bodies writing to preallocated slots give the same result as a serial loop
+    static void parallelFor(size_t n, size_t chunkSize, const Executor &executor, const function<void(size_t, size_t)> &body, size_t align = 1);
+    static void parallelFor(size_t n, size_t chunkSize, int nThreads, const function<void(size_t, size_t)> &body, size_t align = 1);
+};
+
+#endif /* ParallelUtils_hpp */
@@ -0,0 +1,209 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#include "PnP.hpp"
+#include "GeometryUtils.hpp"
+#include "MathUtils.hpp"
+#include "RobustEstimator.hpp"
+
+//number of points of a minimal sample and of models it yields at most
+static const int kP3PSampleSize = 3;
+static const int kP3PMaxModels = 4;
+//fewest inliers of an accepted pose, one more than a minimal sample so that the pose is checked by at least one other point
+static const int kMinInliers = kP3PSampleSize + 1;
+//number of points per word of the packed inlier masks
+static const int kMaskBits = 64;
+
+//draws n distinct indices from [0, end)
+static void drawSample(RNG &rng, int *sample, int n, int end) {
+    for (int i = 0; i < n; i++) {
+        bool unique;
+        do {
+            sample[i] = rng.uniform(0, end);
+            unique = true;
+            for (int j = 0; j < i; j++)
+                unique = unique && (sample[j] != sample[i]);
+        } while (!unique);
+    }
+}
+
+//orthonormal frame (as columns) of the triangle p0 p1 p2: first axis along p0p1, third axis along its normal
+static bool triangleFrame(const Vec3d &p0, const Vec3d &p1, const Vec3d &p2, Matx33d &F) {
+    Vec3d e1 = p1 - p0, e3 = e1.cross(p2 - p0);
+    double n1 = norm(e1), n3 = norm(e3);
+    if ((n1 <= DBL_EPSILON) || (n3 <= DBL_EPSILON*n1))
+        return false;
+    e1 *= 1.0/n1;
+    e3 *= 1.0/n3;
+    Vec3d e2 = e3.cross(e1);
+    F = Matx33d(e1[0], e2[0], e3[0], e1[1], e2[1], e3[1], e1[2], e2[2], e3[2]);
+    return true;
+}
+
+int PnP::p3p(const Vec3d *f, const Vec3d *X, Matx34d *poses) {
+    
+    //sides of the world triangle opposite to points 0, 1, 2 and cosines of the angles between the bearings
+    double a2 = (X[1] - X[2]).dot(X[1] - X[2]), b2 = (X[0] - X[2]).dot(X[0] - X[2]), c2 = (X[0] - X[1]).dot(X[0] - X[1]);
+    double p = f[1].dot(f[2]), q = f[0].dot(f[2]), r = f[0].dot(f[1]);
+    if ((a2 <= 0) || (b2 <= 0) || (c2 <= 0))
+        return 0;
+    
+    //Grunert's quartic in v = s2/s0, the depths s_i along the bearings being s1 = u*s0 and s2 = v*s0
+    double k1 = (a2 - c2)/b2, k2 = (a2 + c2)/b2, ab = a2/b2, cb = c2/b2;
+    double A[5];
+    A[4] = (k1 - 1)*(k1 - 1) - 4*cb*p*p;
+    A[3] = 4*(k1*(1 - k1)*q - (1 - k2)*p*r + 2*cb*p*p*q);
+    A[2] = 2*(k1*k1 - 1 + 2*k1*k1*q*q + 2*(1 - cb)*p*p - 4*k2*p*q*r + 2*(1 - ab)*r*r);
+    A[1] = 4*(-k1*(1 + k1)*q + 2*ab*r*r*q - (1 - k2)*p*r);
+    A[0] = (1 + k1)*(1 + k1) - 4*ab*r*r;
+    
+    double roots[4];
+    int nRoots = MathUtils::polynomialRealRoots(A, 4, roots);
+    
+    Matx33d Fw;
+    if (!triangleFrame(X[0], X[1], X[2], Fw))
+        return 0;
+    
+    int nPoses = 0;
+    for (int i = 0; i < nRoots; i++) {
+        double v = roots[i];
+        double den = 2*(r - v*p), s = 1 + v*v - 2*v*q;
+        if ((fabs(den) <= DBL_EPSILON) || (s <= 0))
+            continue;
+        double u = ((k1 - 1)*v*v - 2*k1*q*v + 1 + k1)/den;
+        double s0 = sqrt(b2/s);
+        if ((u <= 0) || (v <= 0))
+            continue;
+        
+        //points in the camera frame, then the rigid motion aligning the two triangles
+        Vec3d P0 = f[0]*s0, P1 = f[1]*(u*s0), P2 = f[2]*(v*s0);
+        Matx33d Fc;
+        if (!triangleFrame(P0, P1, P2, Fc))
+            continue;
+        Matx33d R = Fc*Fw.t();
+        Matx31d t = Matx31d(P0[0], P0[1], P0[2]) - R*Matx31d(X[0][0], X[0][1], X[0][2]);
+        poses[nPoses++] = CameraModel::poseMatrix(R, t);
+    }
+    return nPoses;
+}
+
+template <typename T>
+bool PnP::estimateImpl(const CameraModel &cam, const Size &imSize, const PointCloud3::View &pts3D, const vector<Point_<T> > &pts2D, PnPResult &result, const PnPParams &params) {
+    
+    int n = (int)pts3D.size();
+    result.nInliers = 0;
+    result.iterations = 0;
+    if (pts2D.size() != pts3D.size()) {
+        cerr << "different numbers of 2d and 3d points" << endl;
+        return false;
+    }
+    if (n < kMinInliers) {
+        cerr << "not enough points" << endl;
+        return false;
+    }
+    
+    size_t nWords = (n + kMaskBits - 1)/kMaskBits;
+    mask.resize(nWords);
+    bestMask.resize(nWords);
+    cams.resize(1);
+    cams[0].setIntrinsics(cam.getK());
+    const Matx33d &Ki = cam.getKinv();
+    
+    //hypothesize and verify
+    RNG rng(params.seed);
+    int best = 0, maxIterations = params.maxIterations, it = 0;
+    Matx34d bestPose;
+    for (; it < maxIterations; it++) {
+        int sample[kP3PSampleSize];
+        drawSample(rng, sample, kP3PSampleSize, n);
+        Vec3d f[kP3PSampleSize], X[kP3PSampleSize];
+        for (int j = 0; j < kP3PSampleSize; j++) {
+            const Point_<T> &pt = pts2D[sample[j]];
+            f[j] = Vec3d(Ki(0,0)*pt.x + Ki(0,1)*pt.y + Ki(0,2), Ki(1,0)*pt.x + Ki(1,1)*pt.y + Ki(1,2), 1);
+            f[j] *= 1.0/norm(f[j]);
+            Matx31d Xj = pts3D[sample[j]];
+            X[j] = Vec3d(Xj(0), Xj(1), Xj(2));
+        }
+        
+        Matx34d poses[kP3PMaxModels];
+        int nPoses = p3p(f, X, poses);
+        for (int m = 0; m < nPoses; m++) {
+            cams[0].setPose(poses[m]);
+            int nInliers = n - GeometryUtils::projectAndFilter(cams[0], imSize, pts3D, &pts2D[0], params.threshold, NULL, NULL, &mask[0]);
+            if (nInliers > best) {
+                best = nInliers;
+                bestPose = poses[m];
+                mask.swap(bestMask);
+                maxIterations = min(maxIterations, RobustEstimator::requiredIterations((double)best/n, kP3PSampleSize, params.confidence, params.maxIterations));
+            }
+        }
+    }
+    result.iterations = it;
+    if (best < kMinInliers) {
+        cerr << "no pose found" << endl;
+        return false;
+    }
+    
+    //refine the pose on the inliers and take the inliers of the refined pose if there are not fewer
+    cams[0].setPose(bestPose);
+    if (params.refine) {
+        inlierTracks.clear();
+        inlierPts.resize(best);
+        int k = 0;
+        for (int i = 0; i < n; i++) {
+            if (!((bestMask[i/kMaskBits] >> (i%kMaskBits)) & 1))
+                continue;
+            Matx31d Xi = pts3D[i];
+            inlierPts.x()[k] = Xi(0);
+            inlierPts.y()[k] = Xi(1);
+            inlierPts.z()[k] = Xi(2);
+            inlierTracks.addObservation(0, Point2d(pts2D[i].x, pts2D[i].y));
+            inlierTracks.endTrack();
+            k++;
+        }
+        refinement.adjust(cams, inlierTracks, inlierPts, Refinement::REFINE_MOTION, 0);
+        int nInliers = n - GeometryUtils::projectAndFilter(cams[0], imSize, pts3D, &pts2D[0], params.threshold, NULL, NULL, &mask[0]);
+        if (nInliers >= best) {
+            best = nInliers;
+            mask.swap(bestMask);
+        }
+        else
+            cams[0].setPose(bestPose);
+    }
+    
+    const Matx34d &P = cams[0].getP();
+    result.R = Matx33d(P(0,0), P(0,1), P(0,2), P(1,0), P(1,1), P(1,2), P(2,0), P(2,1), P(2,2));
+    result.t = Vec3d(P(0,3), P(1,3), P(2,3));
+    result.nInliers = best;
+    result.inliers.resize(n);
+    for (int i = 0; i < n; i++)
+        result.inliers[i] = (bestMask[i/kMaskBits] >> (i%kMaskBits)) & 1;
+    return true;
+}
+
+bool PnP::estimate(const CameraModel &cam, const Size &imSize, const PointCloud3::View &pts3D, const vector<Point2d> &pts2D, PnPResult &result, const PnPParams &params) {
+    return estimateImpl(cam, imSize, pts3D, pts2D, result, params);
+}
+
+bool PnP::estimate(const CameraModel &cam, const Size &imSize, const PointCloud3::View &pts3D, const vector<Point2f> &pts2D, PnPResult &result, const PnPParams &params) {
+    return estimateImpl(cam, imSize, pts3D, pts2D, result, params);
+}
@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef PnP_hpp
+#define PnP_hpp
+
+#include <stdio.h>
+#include <opencv2/opencv.hpp>
+#include "CameraModel.hpp"
+#include "PointCloud3.hpp"
+#include "TrackTable.hpp"
+#include "Refinement.hpp"
+
+using namespace std;
+using namespace cv;
+
+struct PnPParams {
+    double threshold = 3.0;         //inlier reprojection threshold in pixels, as in GeometryUtils::filterOutliers
+    double confidence = 0.99;       //probability of having drawn an all-inlier sample when stopping
+    int maxIterations = 1000;
+    bool refine = true;             //Levenberg-Marquardt refinement of the pose on the inliers
+    uint64 seed = 0x5eed;           //random seed, the result is deterministic for a given seed
+};
+
+struct PnPResult {
+    Matx33d R;                      //pose [R|t] of the camera (world to camera)
+    Vec3d t;
+    vector<uchar> inliers;          //1 for inliers, in the order of the input points
+    int nInliers = 0;
+    int iterations = 0;             //number of samples drawn
+};
+
+//Camera pose from 2D-3D matches: P3P (Grunert) minimal solver in a RANSAC loop scored with GeometryUtils::projectAndFilter, then
+//a motion only Refinement on the inliers and a final projectAndFilter pass for the inlier mask. The instance is the workspace:
+//its mask words, inlier table and refinement buffers grow to the largest problem seen and are reused by the following calls, so
+//tracking frame after frame with one PnP (and one PnPResult) does not allocate in steady state
+class PnP {
+    
+public:
+    
+    //Pose of a camera with the intrinsics of cam (its pose is ignored) observing pts3D at pts2D in an image of size imSize (points
+    //projecting outside it count as outliers). Returns false if no pose with at least 4 inliers was found
+    bool estimate(const CameraModel &cam, const Size &imSize, const PointCloud3::View &pts3D, const vector<Point2d> &pts2D, PnPResult &result, const PnPParams &params = PnPParams());
+    bool estimate(const CameraModel &cam, const Size &imSize, const PointCloud3::View &pts3D, const vector<Point2f> &pts2D, PnPResult &result, const PnPParams &params = PnPParams());
+    
+    //P3P from the unit bearing vectors f[i] = K.inv()*[x y 1] (normalised) of the world points X[i]. Writes the up to 4 poses
+    //[R|t] to poses and returns their number
+    static int p3p(const Vec3d *f, const Vec3d *X, Matx34d *poses);
+    
+private:
+    
+    template <typename T>
+    bool estimateImpl(const CameraModel &cam, const Size &imSize, const PointCloud3::View &pts3D, const vector<Point_<T> > &pts2D, PnPResult &result, const PnPParams &params);
+    
+    vector<uint64> mask, bestMask;  //packed inlier masks, see GeometryUtils::projectAndFilter
+    vector<CameraModel> cams;
+    TrackTable inlierTracks;
+    PointCloud3 inlierPts;
+    Refinement refinement;
+};
+
+#endif /* PnP_hpp */
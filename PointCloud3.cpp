@@ -0,0 +1,138 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#include "PointCloud3.hpp"
+
+//alignment of every coordinate array, in doubles
+static const size_t kAlignDoubles = 8;
+
+PointCloud3::View::View(const vector<Matx31d> &pts) : w(NULL), n(pts.size()), stride(3) {
+    x = n ? pts[0].val : NULL;
+    y = n ? pts[0].val + 1 : NULL;
+    z = n ? pts[0].val + 2 : NULL;
+}
+
+PointCloud3::View PointCloud3::View::subview(size_t begin, size_t end) const {
+    size_t o = begin*stride;
+    return View(x + o, y + o, z + o, w ? w + o : NULL, end - begin, stride);
+}
+
+PointCloud3::PointCloud3() : data(NULL), px(NULL), py(NULL), pz(NULL), pw(NULL), count(0), capacity(0), homogeneous(false) {
+}
+
+PointCloud3::PointCloud3(size_t n, bool homogeneous) : data(NULL), px(NULL), py(NULL), pz(NULL), pw(NULL), count(0), capacity(0), homogeneous(homogeneous) {
+    resize(n);
+}
+
+PointCloud3::PointCloud3(const vector<Matx31d> &pts) : data(NULL), px(NULL), py(NULL), pz(NULL), pw(NULL), count(0), capacity(0), homogeneous(false) {
+    fromMatx(pts);
+}
+
+PointCloud3::PointCloud3(const PointCloud3 &other) : data(NULL), px(NULL), py(NULL), pz(NULL), pw(NULL), count(0), capacity(0), homogeneous(other.homogeneous) {
+    *this = other;
+}
+
+PointCloud3 &PointCloud3::operator=(const PointCloud3 &other) {
+    if (this == &other)
+        return *this;
+    homogeneous = other.homogeneous;
+    count = 0;
+    allocate(other.count, 0);
+    count = other.count;
+    if (count) {
+        memcpy(px, other.px, count*sizeof(double));
+        memcpy(py, other.py, count*sizeof(double));
+        memcpy(pz, other.pz, count*sizeof(double));
+        if (homogeneous)
+            memcpy(pw, other.pw, count*sizeof(double));
+    }
+    return *this;
+}
+
+PointCloud3::~PointCloud3() {
+    fastFree(data);
+}
+
+void PointCloud3::allocate(size_t n, size_t keep) {
+    
+    //one block holding every array, each padded to a multiple of the alignment
+    size_t stride = (n + kAlignDoubles - 1)/kAlignDoubles*kAlignDoubles;
+    int nArrays = homogeneous ? 4 : 3;
+    double *block = stride ? (double*)fastMalloc((nArrays*stride + kAlignDoubles)*sizeof(double)) : NULL;
+    double *base = block ? alignPtr(block, (int)(kAlignDoubles*sizeof(double))) : NULL;
+    double *nx = base, *ny = base + stride, *nz = base + 2*stride, *nw = homogeneous ? base + 3*stride : NULL;
+    
+    if (keep) {
+        memcpy(nx, px, keep*sizeof(double));
+        memcpy(ny, py, keep*sizeof(double));
+        memcpy(nz, pz, keep*sizeof(double));
+        if (homogeneous)
+            memcpy(nw, pw, keep*sizeof(double));
+    }
+    fastFree(data);
+    data = block;
+    px = nx;
+    py = ny;
+    pz = nz;
+    pw = block ? nw : NULL;
+    capacity = stride;
+}
+
+void PointCloud3::reserve(size_t n) {
+    if (n > capacity)
+        allocate(n, count);
+}
+
+void PointCloud3::resize(size_t n) {
+    reserve(n);
+    if (homogeneous)
+        for (size_t i = count; i < n; i++)
+            pw[i] = 1.0;
+    count = n;
+}
+
+void PointCloud3::push_back(double x, double y, double z, double w) {
+    if (count == capacity)
+        reserve(max((size_t)kAlignDoubles, 2*capacity));
+    px[count] = x;
+    py[count] = y;
+    pz[count] = z;
+    if (homogeneous)
+        pw[count] = w;
+    count++;
+}
+
+void PointCloud3::fromMatx(const vector<Matx31d> &pts) {
+    resize(pts.size());
+    for (size_t i = 0; i < pts.size(); i++) {
+        px[i] = pts[i](0);
+        py[i] = pts[i](1);
+        pz[i] = pts[i](2);
+    }
+}
+
+void PointCloud3::toMatx(vector<Matx31d> &pts) const {
+    size_t offset = pts.size();
+    pts.resize(offset + count);
+    for (size_t i = 0; i < count; i++)
+        pts[offset + i] = Matx31d(px[i], py[i], pz[i]);
+}
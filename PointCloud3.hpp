@@ -0,0 +1,99 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef PointCloud3_hpp
+#define PointCloud3_hpp
+
+#include <stdio.h>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+//3D points in structure-of-arrays layout: one contiguous x, y, z (and optionally w) array each, every array starting on a
+//64 byte boundary so kernels can stream and vectorise over them
+class PointCloud3 {
+    
+public:
+    
+    //read-only view of n points at x[i*stride], y[i*stride], z[i*stride] (w may be NULL). Views of a PointCloud3 have stride 1,
+    //views of a vector<Matx31d> have stride 3 and point into the vector, so neither copies anything
+    struct View {
+        const double *x, *y, *z, *w;
+        size_t n, stride;
+        
+        View() : x(NULL), y(NULL), z(NULL), w(NULL), n(0), stride(1) {}
+        View(const double *x, const double *y, const double *z, const double *w, size_t n, size_t stride) : x(x), y(y), z(z), w(w), n(n), stride(stride) {}
+        View(const vector<Matx31d> &pts);
+        
+        size_t size() const { return n; }
+        Matx31d operator[](size_t i) const { return Matx31d(x[i*stride], y[i*stride], z[i*stride]); }
+        //points [begin, end)
+        View subview(size_t begin, size_t end) const;
+    };
+    
+    PointCloud3();
+    explicit PointCloud3(size_t n, bool homogeneous = false);
+    explicit PointCloud3(const vector<Matx31d> &pts);
+    PointCloud3(const PointCloud3 &other);
+    PointCloud3 &operator=(const PointCloud3 &other);
+    ~PointCloud3();
+    
+    //contents are kept up to min(size, n)
+    void resize(size_t n);
+    void reserve(size_t n);
+    void clear() { count = 0; }
+    void push_back(double x, double y, double z, double w = 1.0);
+    void push_back(const Matx31d &pt) { push_back(pt(0), pt(1), pt(2)); }
+    
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    //true if the cloud has a w array
+    bool isHomogeneous() const { return homogeneous; }
+    
+    double *x() { return px; }
+    double *y() { return py; }
+    double *z() { return pz; }
+    double *w() { return pw; }
+    const double *x() const { return px; }
+    const double *y() const { return py; }
+    const double *z() const { return pz; }
+    const double *w() const { return pw; }
+    
+    Matx31d operator[](size_t i) const { return Matx31d(px[i], py[i], pz[i]); }
+    View view() const { return View(px, py, pz, pw, count, 1); }
+    View view(size_t begin, size_t end) const { return view().subview(begin, end); }
+    
+    //conversion to and from the AoS layout used by the rest of the API; toMatx appends to pts
+    void fromMatx(const vector<Matx31d> &pts);
+    void toMatx(vector<Matx31d> &pts) const;
+    
+private:
+    void allocate(size_t capacity, size_t keep);
+    
+    double *data;
+    double *px, *py, *pz, *pw;
+    size_t count, capacity;
+    bool homogeneous;
+};
+
+#endif /* PointCloud3_hpp */
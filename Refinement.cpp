@@ -0,0 +1,503 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#include "Refinement.hpp"
+#include "ParallelUtils.hpp"
+#include <float.h>
+
+//number of points per work item of the parallel point refinement
+static const size_t kRefinementChunk = 256;
+//damping increases tried before giving up on a step
+static const int kMaxDampingTries = 10;
+
+//Projects the world point X with cam and computes the Jacobian Jc of the pixel with respect to the camera frame point Xc = R*X + t.
+//Returns false if X is not in front of the camera
+static inline bool projectWithJacobian(const CameraModel &cam, const double *X, double *Xc, double &u, double &v, double Jc[2][3]) {
+    
+    const Matx34d &P = cam.getP();
+    const Matx33d &K = cam.getK();
+    for (int r = 0; r < 3; r++)
+        Xc[r] = P(r,0)*X[0] + P(r,1)*X[1] + P(r,2)*X[2] + P(r,3);
+    double iz = 1.0/Xc[2], a = Xc[0]*iz, b = Xc[1]*iz;
+    u = K(0,0)*a + K(0,1)*b + K(0,2);
+    v = K(1,1)*b + K(1,2);
+    Jc[0][0] = K(0,0)*iz;
+    Jc[0][1] = K(0,1)*iz;
+    Jc[0][2] = -(K(0,0)*a + K(0,1)*b)*iz;
+    Jc[1][0] = 0;
+    Jc[1][1] = K(1,1)*iz;
+    Jc[1][2] = -K(1,1)*b*iz;
+    return Xc[2] > 0;
+}
+
+//Jacobian of the pixel with respect to the world point, Jc*R
+static inline void pointJacobian(const Matx34d &P, const double Jc[2][3], double Jp[2][3]) {
+    for (int r = 0; r < 2; r++)
+        for (int j = 0; j < 3; j++)
+            Jp[r][j] = Jc[r][0]*P(0,j) + Jc[r][1]*P(1,j) + Jc[r][2]*P(2,j);
+}
+
+//Jacobian of the pixel with respect to the pose update (w, dt): dXc/dw = -[Xc]x and dXc/dt = I
+static inline void poseJacobian(const double *Xc, const double Jc[2][3], double Jw[2][6]) {
+    for (int r = 0; r < 2; r++) {
+        Jw[r][0] = Jc[r][2]*Xc[1] - Jc[r][1]*Xc[2];
+        Jw[r][1] = Jc[r][0]*Xc[2] - Jc[r][2]*Xc[0];
+        Jw[r][2] = Jc[r][1]*Xc[0] - Jc[r][0]*Xc[1];
+        Jw[r][3] = Jc[r][0];
+        Jw[r][4] = Jc[r][1];
+        Jw[r][5] = Jc[r][2];
+    }
+}
+
+//rotation matrix of the rotation vector w (Rodrigues' formula)
+static Matx33d rotationExp(double wx, double wy, double wz) {
+    double theta = sqrt(wx*wx + wy*wy + wz*wz);
+    Matx33d Wx(0, -wz, wy, wz, 0, -wx, -wy, wx, 0);
+    if (theta < 1e-12)
+        return Matx33d::eye() + Wx;
+    double a = sin(theta)/theta, b = (1 - cos(theta))/(theta*theta);
+    return Matx33d::eye() + a*Wx + b*(Wx*Wx);
+}
+
+//applies the pose update (w, dt) to cam
+static void updatePose(CameraModel &cam, const double *d) {
+    const Matx34d &P = cam.getP();
+    Matx33d E = rotationExp(d[0], d[1], d[2]);
+    Matx33d R(P(0,0), P(0,1), P(0,2), P(1,0), P(1,1), P(1,2), P(2,0), P(2,1), P(2,2));
+    Matx31d t = E*Matx31d(P(0,3), P(1,3), P(2,3));
+    cam.setPose(E*R, Matx31d(t(0) + d[3], t(1) + d[4], t(2) + d[5]));
+}
+
+//In place Cholesky solve of the n x n system A*x = b (A row major, overwritten by its factor). Returns false if A is not positive
+//definite
+static bool choleskySolve(double *A, double *b, int n) {
+    for (int j = 0; j < n; j++) {
+        double *Aj = A + j*n;
+        double d = Aj[j];
+        for (int k = 0; k < j; k++)
+            d -= Aj[k]*Aj[k];
+        if (!(d > 0))
+            return false;
+        d = sqrt(d);
+        Aj[j] = d;
+        double id = 1.0/d;
+        for (int i = j + 1; i < n; i++) {
+            double *Ai = A + i*n;
+            double s = Ai[j];
+            for (int k = 0; k < j; k++)
+                s -= Ai[k]*Aj[k];
+            Ai[j] = s*id;
+        }
+    }
+    
+    //L*y = b, then L^T*x = y
+    for (int i = 0; i < n; i++) {
+        const double *Ai = A + i*n;
+        double s = b[i];
+        for (int k = 0; k < i; k++)
+            s -= Ai[k]*b[k];
+        b[i] = s/Ai[i];
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        double s = b[i];
+        for (int k = i + 1; k < n; k++)
+            s -= A[k*n + i]*b[k];
+        b[i] = s/A[i*n + i];
+    }
+    return true;
+}
+
+//inverse of the symmetric positive definite 3x3 matrix A by cofactors, returns false if it is singular
+static inline bool invertSymmetric3x3(const double *A, double *Ai) {
+    double c00 = A[4]*A[8] - A[5]*A[7];
+    double c01 = A[2]*A[7] - A[1]*A[8];
+    double c02 = A[1]*A[5] - A[2]*A[4];
+    double det = A[0]*c00 + A[3]*c01 + A[6]*c02;
+    if (!(fabs(det) > DBL_MIN))
+        return false;
+    double id = 1.0/det;
+    Ai[0] = c00*id;
+    Ai[1] = Ai[3] = c01*id;
+    Ai[2] = Ai[6] = c02*id;
+    Ai[4] = (A[0]*A[8] - A[2]*A[6])*id;
+    Ai[5] = Ai[7] = (A[2]*A[3] - A[0]*A[5])*id;
+    Ai[8] = (A[0]*A[4] - A[1]*A[3])*id;
+    return true;
+}
+
+static inline bool finitePoint(const double *X) {
+    return std::isfinite(X[0]) && std::isfinite(X[1]) && std::isfinite(X[2]);
+}
+
+//squared reprojection error of one point over its m observations, DBL_MAX if it is behind one of the cameras
+static double pointCost(const CameraModel *cams, const int *view, const Point2d *obs, int m, const double *X) {
+    double cost = 0, Xc[3], u, v, Jc[2][3];
+    for (int k = 0; k < m; k++) {
+        if (!projectWithJacobian(cams[view[k]], X, Xc, u, v, Jc))
+            return DBL_MAX;
+        cost += (obs[k].x - u)*(obs[k].x - u) + (obs[k].y - v)*(obs[k].y - v);
+    }
+    return cost;
+}
+
+//total squared reprojection error of the valid points, DBL_MAX if one of them is behind a camera
+static double totalCost(const vector<CameraModel> &cams, const TrackTable &tracks, const PointCloud3 &pts, const vector<char> &valid) {
+    double cost = 0;
+    for (size_t i = 0; i < tracks.size(); i++) {
+        if (!valid[i])
+            continue;
+        double X[3] = {pts.x()[i], pts.y()[i], pts.z()[i]};
+        int first = tracks.start[i];
+        double c = pointCost(&cams[0], &tracks.view[first], &tracks.pts[first], tracks.length(i), X);
+        if (c == DBL_MAX)
+            return DBL_MAX;
+        cost += c;
+    }
+    return cost;
+}
+
+//Levenberg-Marquardt on one point with the cameras fixed, entirely on the stack. Returns the final cost
+static double refinePoint(const CameraModel *cams, const int *view, const Point2d *obs, int m, const RefinementParams &params, double *X) {
+    
+    double lambda = params.initialLambda;
+    double cost = pointCost(cams, view, obs, m, X);
+    for (int it = 0; (it < params.maxIterations) && (cost < DBL_MAX); it++) {
+        //normal equations
+        double H[9] = {0}, g[3] = {0}, Xc[3], u, v, Jc[2][3], Jp[2][3];
+        for (int k = 0; k < m; k++) {
+            projectWithJacobian(cams[view[k]], X, Xc, u, v, Jc);
+            pointJacobian(cams[view[k]].getP(), Jc, Jp);
+            double r[2] = {obs[k].x - u, obs[k].y - v};
+            for (int a = 0; a < 3; a++) {
+                for (int b = 0; b < 3; b++)
+                    H[a*3 + b] += Jp[0][a]*Jp[0][b] + Jp[1][a]*Jp[1][b];
+                g[a] += Jp[0][a]*r[0] + Jp[1][a]*r[1];
+            }
+        }
+        
+        //increase the damping until the step lowers the cost
+        bool accepted = false;
+        double newCost = cost;
+        for (int t = 0; (t < kMaxDampingTries) && !accepted; t++, lambda *= 10) {
+            double Hd[9], Hi[9];
+            memcpy(Hd, H, sizeof(Hd));
+            for (int a = 0; a < 3; a++)
+                Hd[a*4] *= 1 + lambda;
+            if (!invertSymmetric3x3(Hd, Hi))
+                continue;
+            double Xn[3];
+            for (int a = 0; a < 3; a++)
+                Xn[a] = X[a] + Hi[a*3]*g[0] + Hi[a*3 + 1]*g[1] + Hi[a*3 + 2]*g[2];
+            newCost = pointCost(cams, view, obs, m, Xn);
+            if (newCost < cost) {
+                memcpy(X, Xn, sizeof(Xn));
+                accepted = true;
+                lambda *= 0.01;
+            }
+        }
+        if (!accepted)
+            break;
+        double decrease = cost - newCost;
+        cost = newCost;
+        if (decrease <= params.minRelativeDecrease*(cost + decrease))
+            break;
+    }
+    return cost;
+}
+
+void Refinement::refinePoints(const vector<CameraModel> &cams, const TrackTable &tracks, PointCloud3 &pts, const RefinementParams &params, vector<double> *errors, int nThreads) {
+    
+    size_t n = min(tracks.size(), pts.size());
+    if (errors)
+        errors->assign(n, NAN);
+    if (n == 0)
+        return;
+    
+    double *px = pts.x(), *py = pts.y(), *pz = pts.z();
+    double *err = errors ? &(*errors)[0] : NULL;
+    ParallelUtils::parallelFor(n, kRefinementChunk, nThreads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            double X[3] = {px[i], py[i], pz[i]};
+            int first = tracks.start[i], m = tracks.length(i);
+            if ((m < 2) || !finitePoint(X))
+                continue;
+            double cost = refinePoint(&cams[0], &tracks.view[first], &tracks.pts[first], m, params, X);
+            px[i] = X[0];
+            py[i] = X[1];
+            pz[i] = X[2];
+            if (err)
+                err[i] = sqrt(cost/m);
+        }
+    });
+}
+
+double Refinement::linearize(const vector<CameraModel> &cams, const TrackTable &tracks, const PointCloud3 &pts, bool motion, bool structure) {
+    
+    size_t n = tracks.size();
+    if (motion) {
+        U.assign(36*nFree, 0);
+        gc.assign(6*nFree, 0);
+        W.assign(18*tracks.nObservations(), 0);
+    }
+    if (structure) {
+        V.assign(9*n, 0);
+        gp.assign(3*n, 0);
+    }
+    
+    double cost = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!pointValid[i])
+            continue;
+        double X[3] = {pts.x()[i], pts.y()[i], pts.z()[i]}, Xc[3], u, v, Jc[2][3], Jp[2][3], Jw[2][6];
+        double *Vi = structure ? &V[9*i] : NULL, *gi = structure ? &gp[3*i] : NULL;
+        for (int k = tracks.start[i]; k < tracks.start[i + 1]; k++) {
+            const CameraModel &cam = cams[tracks.view[k]];
+            projectWithJacobian(cam, X, Xc, u, v, Jc);
+            double r[2] = {tracks.pts[k].x - u, tracks.pts[k].y - v};
+            cost += r[0]*r[0] + r[1]*r[1];
+            
+            if (structure) {
+                pointJacobian(cam.getP(), Jc, Jp);
+                for (int a = 0; a < 3; a++) {
+                    for (int b = 0; b < 3; b++)
+                        Vi[a*3 + b] += Jp[0][a]*Jp[0][b] + Jp[1][a]*Jp[1][b];
+                    gi[a] += Jp[0][a]*r[0] + Jp[1][a]*r[1];
+                }
+            }
+            
+            int c = freeIndex[tracks.view[k]];
+            if (!motion || (c < 0))
+                continue;
+            poseJacobian(Xc, Jc, Jw);
+            double *Uc = &U[36*c], *gcc = &gc[6*c];
+            for (int a = 0; a < 6; a++) {
+                for (int b = 0; b < 6; b++)
+                    Uc[a*6 + b] += Jw[0][a]*Jw[0][b] + Jw[1][a]*Jw[1][b];
+                gcc[a] += Jw[0][a]*r[0] + Jw[1][a]*r[1];
+            }
+            if (structure) {
+                double *Wk = &W[18*k];
+                for (int a = 0; a < 6; a++)
+                    for (int b = 0; b < 3; b++)
+                        Wk[a*3 + b] = Jw[0][a]*Jp[0][b] + Jw[1][a]*Jp[1][b];
+            }
+        }
+    }
+    return cost;
+}
+
+bool Refinement::solveStep(const TrackTable &tracks, bool motion, bool structure, double lambda) {
+    
+    size_t n = tracks.size();
+    int nc = 6*nFree;
+    
+    //damped point blocks
+    if (structure) {
+        Vinv.resize(9*n);
+        for (size_t i = 0; i < n; i++) {
+            if (!pointValid[i])
+                continue;
+            double Vd[9];
+            memcpy(Vd, &V[9*i], sizeof(Vd));
+            for (int a = 0; a < 3; a++)
+                Vd[a*4] *= 1 + lambda;
+            if (!invertSymmetric3x3(Vd, &Vinv[9*i]))
+                return false;
+        }
+    }
+    
+    dc.assign(nc, 0);
+    if (motion && (nc > 0)) {
+        //reduced camera system S = U - W*V^-1*W^T, rhs = gc - W*V^-1*gp
+        S.assign(nc*nc, 0);
+        rhs = gc;
+        for (int c = 0; c < nFree; c++)
+            for (int a = 0; a < 6; a++)
+                for (int b = 0; b < 6; b++)
+                    S[(6*c + a)*nc + 6*c + b] = U[36*c + a*6 + b]*((a == b) ? 1 + lambda : 1);
+        
+        for (size_t i = 0; structure && (i < n); i++) {
+            if (!pointValid[i])
+                continue;
+            const double *Vi = &Vinv[9*i], *gi = &gp[3*i];
+            for (int k = tracks.start[i]; k < tracks.start[i + 1]; k++) {
+                int ck = freeIndex[tracks.view[k]];
+                if (ck < 0)
+                    continue;
+                
+                //Y = W_k*V^-1
+                const double *Wk = &W[18*k];
+                double Y[6][3];
+                for (int a = 0; a < 6; a++)
+                    for (int b = 0; b < 3; b++)
+                        Y[a][b] = Wk[a*3]*Vi[b] + Wk[a*3 + 1]*Vi[3 + b] + Wk[a*3 + 2]*Vi[6 + b];
+                for (int a = 0; a < 6; a++)
+                    rhs[6*ck + a] -= Y[a][0]*gi[0] + Y[a][1]*gi[1] + Y[a][2]*gi[2];
+                
+                for (int l = tracks.start[i]; l < tracks.start[i + 1]; l++) {
+                    int cl = freeIndex[tracks.view[l]];
+                    if (cl < 0)
+                        continue;
+                    const double *Wl = &W[18*l];
+                    for (int a = 0; a < 6; a++) {
+                        double *Srow = &S[(6*ck + a)*nc + 6*cl];
+                        for (int b = 0; b < 6; b++)
+                            Srow[b] -= Y[a][0]*Wl[b*3] + Y[a][1]*Wl[b*3 + 1] + Y[a][2]*Wl[b*3 + 2];
+                    }
+                }
+            }
+        }
+        
+        if (!choleskySolve(&S[0], &rhs[0], nc))
+            return false;
+        dc = rhs;
+    }
+    
+    //back substitution of the points, dp = V^-1*(gp - W^T*dc)
+    if (structure) {
+        dp.assign(3*n, 0);
+        for (size_t i = 0; i < n; i++) {
+            if (!pointValid[i])
+                continue;
+            double g[3] = {gp[3*i], gp[3*i + 1], gp[3*i + 2]};
+            for (int k = tracks.start[i]; motion && (k < tracks.start[i + 1]); k++) {
+                int c = freeIndex[tracks.view[k]];
+                if (c < 0)
+                    continue;
+                const double *Wk = &W[18*k];
+                for (int b = 0; b < 3; b++)
+                    for (int a = 0; a < 6; a++)
+                        g[b] -= Wk[a*3 + b]*dc[6*c + a];
+            }
+            const double *Vi = &Vinv[9*i];
+            for (int a = 0; a < 3; a++)
+                dp[3*i + a] = Vi[a*3]*g[0] + Vi[a*3 + 1]*g[1] + Vi[a*3 + 2]*g[2];
+        }
+    }
+    return true;
+}
+
+bool Refinement::adjust(vector<CameraModel> &cams, const TrackTable &tracks, PointCloud3 &pts, int mode, int nFixedCameras, const RefinementParams &params, RefinementResult *result) {
+    
+    bool motion = (mode & REFINE_MOTION) != 0, structure = (mode & REFINE_STRUCTURE) != 0;
+    if (pts.size() != tracks.size()) {
+        cerr << "one point per track expected" << endl;
+        return false;
+    }
+    for (size_t k = 0; k < tracks.nObservations(); k++) {
+        if ((tracks.view[k] < 0) || (tracks.view[k] >= (int)cams.size())) {
+            cerr << "track observation of an unknown camera" << endl;
+            return false;
+        }
+    }
+    
+    //points that cannot be projected by all their cameras stay out, they would make every cost infinite
+    RefinementResult res;
+    size_t n = tracks.size();
+    pointValid.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        double X[3] = {pts.x()[i], pts.y()[i], pts.z()[i]};
+        int first = tracks.start[i], m = tracks.length(i);
+        pointValid[i] = finitePoint(X) && (m > 0) && (pointCost(&cams[0], &tracks.view[first], &tracks.pts[first], m, X) < DBL_MAX);
+        res.nObservations += pointValid[i] ? m : 0;
+        res.nPointsLeftOut += !pointValid[i];
+    }
+    
+    //free cameras observing none of the valid points would leave a zero block in S, so they are fixed too
+    int firstFree = motion ? max(0, min(nFixedCameras, (int)cams.size())) : (int)cams.size();
+    vector<char> observed(cams.size(), 0);
+    for (size_t i = 0; i < n; i++)
+        for (int k = tracks.start[i]; pointValid[i] && (k < tracks.start[i + 1]); k++)
+            observed[tracks.view[k]] = 1;
+    freeIndex.assign(cams.size(), -1);
+    nFree = 0;
+    for (int c = firstFree; c < (int)cams.size(); c++) {
+        if (observed[c])
+            freeIndex[c] = nFree++;
+        else
+            res.nCamerasLeftOut++;
+    }
+    
+    double lambda = params.initialLambda;
+    double cost = totalCost(cams, tracks, pts, pointValid);
+    res.initialCost = cost;
+    if ((n > 0) && (res.nObservations == 0)) {
+        cerr << "no point can be projected by all of its cameras" << endl;
+        if (result)
+            *result = res;
+        return false;
+    }
+    if (!(cost < DBL_MAX)) {
+        cerr << "initial reprojection error is not finite" << endl;
+        if (result)
+            *result = res;
+        return false;
+    }
+    for (int it = 0; (it < params.maxIterations) && (cost < DBL_MAX); it++) {
+        linearize(cams, tracks, pts, motion, structure);
+        
+        //increase the damping until the step lowers the cost
+        bool accepted = false;
+        double newCost = cost;
+        for (int t = 0; (t < kMaxDampingTries) && !accepted; t++, lambda *= 10) {
+            if (!solveStep(tracks, motion, structure, lambda))
+                continue;
+            
+            camsTrial = cams;
+            for (size_t c = 0; c < cams.size(); c++)
+                if (freeIndex[c] >= 0)
+                    updatePose(camsTrial[c], &dc[6*freeIndex[c]]);
+            if (structure) {
+                ptsTrial.resize(n);
+                //dp is zero for the points left out
+                for (size_t i = 0; i < n; i++) {
+                    ptsTrial.x()[i] = pts.x()[i] + dp[3*i];
+                    ptsTrial.y()[i] = pts.y()[i] + dp[3*i + 1];
+                    ptsTrial.z()[i] = pts.z()[i] + dp[3*i + 2];
+                }
+            }
+            
+            newCost = totalCost(camsTrial, tracks, structure ? ptsTrial : pts, pointValid);
+            if (newCost < cost) {
+                cams.swap(camsTrial);
+                if (structure) {
+                    memcpy(pts.x(), ptsTrial.x(), n*sizeof(double));
+                    memcpy(pts.y(), ptsTrial.y(), n*sizeof(double));
+                    memcpy(pts.z(), ptsTrial.z(), n*sizeof(double));
+                }
+                accepted = true;
+                lambda *= 0.01;
+            }
+        }
+        if (!accepted)
+            break;
+        res.iterations++;
+        double decrease = cost - newCost;
+        cost = newCost;
+        if (decrease <= params.minRelativeDecrease*(cost + decrease))
+            break;
+    }
+    res.finalCost = cost;
+    if (result)
+        *result = res;
+    return true;
+}
@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef Refinement_hpp
+#define Refinement_hpp
+
+#include <stdio.h>
+#include <opencv2/opencv.hpp>
+#include "CameraModel.hpp"
+#include "PointCloud3.hpp"
+#include "TrackTable.hpp"
+
+using namespace std;
+using namespace cv;
+
+struct RefinementParams {
+    int maxIterations = 20;
+    double initialLambda = 1e-3;        //initial Levenberg-Marquardt damping, relative to the diagonal of the normal equations
+    double minRelativeDecrease = 1e-6;  //stop once an accepted step lowers the cost by less than this fraction of it
+};
+
+struct RefinementResult {
+    double initialCost = 0;             //sum of the squared reprojection errors in pixels before and after refinement
+    double finalCost = 0;
+    int iterations = 0;                 //number of accepted steps
+    int nObservations = 0;
+    int nPointsLeftOut = 0;             //points not finite, without observations or behind one of their cameras
+    int nCamerasLeftOut = 0;            //free cameras without observations of the other points, kept fixed
+};
+
+//Levenberg-Marquardt refinement of triangulated points and camera poses on the reprojection error of the CameraModel projection,
+//with analytic Jacobians. Point i of a cloud is the point of track i of the TrackTable, whose view indices refer to the camera array.
+//Pose updates are rotation vectors applied on the left, R = exp(w)*R and t = exp(w)*t + dt. The instance keeps its workspace, so
+//adjusting keyframe after keyframe with one Refinement does not allocate once the largest problem has been seen
+class Refinement {
+    
+public:
+    
+    enum Mode {
+        REFINE_STRUCTURE = 1,           //points only, poses fixed
+        REFINE_MOTION = 2,              //poses only, points fixed
+        REFINE_ALL = 3                  //poses and points, points eliminated with the Schur complement
+    };
+    
+    //Structure only refinement: every point is refined independently on its own 3x3 system, in stack memory, with the poses fixed.
+    //Points are spread over nThreads threads. errors, if given, receives the RMS reprojection error of every point in pixels. Points
+    //that are not finite or have fewer than two observations are left as they are
+    static void refinePoints(const vector<CameraModel> &cams, const TrackTable &tracks, PointCloud3 &pts, const RefinementParams &params = RefinementParams(), vector<double> *errors = NULL, int nThreads = 1);
+    
+    //Small scale bundle adjustment of the poses of cams[nFixedCameras...] and/or the points, depending on mode. The first nFixedCameras
+    //cameras fix the gauge. With REFINE_ALL every step solves the reduced camera system S = U - W*V^-1*W^T, dense 6x6 blocks per free
+    //camera, by Cholesky and back substitutes the points. Points that are not finite or are behind one of their cameras are left as they
+    //are and out of the cost, and so are free cameras that observe none of the other points. Returns false if the inputs are
+    //inconsistent, no point is left or the initial cost is not finite
+    bool adjust(vector<CameraModel> &cams, const TrackTable &tracks, PointCloud3 &pts, int mode = REFINE_ALL, int nFixedCameras = 1, const RefinementParams &params = RefinementParams(), RefinementResult *result = NULL);
+    
+private:
+    
+    //normal equations of the current estimate; returns the cost
+    double linearize(const vector<CameraModel> &cams, const TrackTable &tracks, const PointCloud3 &pts, bool motion, bool structure);
+    
+    //damped step into dc and dp, returns false if the reduced system is not positive definite
+    bool solveStep(const TrackTable &tracks, bool motion, bool structure, double lambda);
+    
+    //workspace: camera blocks U (6x6) and gradients gc, point blocks V (3x3) and gradients gp, camera-point blocks W (6x3) per
+    //observation, the reduced system S and the steps. freeIndex is the index of each camera among the free ones, -1 if it is fixed
+    int nFree;
+    vector<int> freeIndex;
+    vector<char> pointValid;
+    vector<double> U, gc, V, gp, W, Vinv, S, rhs, dc, dp;
+    vector<CameraModel> camsTrial;
+    PointCloud3 ptsTrial;
+};
+
+#endif /* Refinement_hpp */
@@ -0,0 +1,384 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#include "RobustEstimator.hpp"
+#include "VectorUtils.hpp"
+
+//number of correspondences verified between two SPRT decisions
+static const int kVerifyBlock = 256;
+//PROSAC: number of samples after which sampling becomes uniform (T_N in Chum and Matas)
+static const double kProsacTN = 200000;
+
+//similarity transform moving the centroid of the points to the origin at mean distance sqrt(2)
+static Matx33d normalisingTransform(const Point2d *pts, const int *idx, int n) {
+    
+    double cx = 0, cy = 0, d = 0;
+    for (int i = 0; i < n; i++) {
+        cx += pts[idx[i]].x;
+        cy += pts[idx[i]].y;
+    }
+    cx /= n;
+    cy /= n;
+    for (int i = 0; i < n; i++)
+        d += sqrt((pts[idx[i]].x - cx)*(pts[idx[i]].x - cx) + (pts[idx[i]].y - cy)*(pts[idx[i]].y - cy));
+    double s = (d > 0) ? sqrt(2.0)*n/d : 1.0;
+    return Matx33d(s, 0, -s*cx, 0, s, -s*cy, 0, 0, 1);
+}
+
+//right singular vector of the smallest singular value of the system accumulated in AtA
+static Matx33d nullVector(const Matx<double,9,9> &AtA) {
+    
+    Matx<double,9,1> w;
+    Matx<double,9,9> u, vt;
+    SVD::compute(AtA, w, u, vt);
+    return Matx33d(vt(8,0), vt(8,1), vt(8,2), vt(8,3), vt(8,4), vt(8,5), vt(8,6), vt(8,7), vt(8,8));
+}
+
+//adds the row r to the normal matrix of the linear system
+static inline void accumulateRow(Matx<double,9,9> &AtA, const double *r) {
+    for (int i = 0; i < 9; i++)
+        for (int j = i; j < 9; j++)
+            AtA(i,j) += r[i]*r[j];
+}
+
+static inline void symmetrise(Matx<double,9,9> &AtA) {
+    for (int i = 0; i < 9; i++)
+        for (int j = 0; j < i; j++)
+            AtA(i,j) = AtA(j,i);
+}
+
+//linear estimate of M with x1^T*M*x0 = 0 from the transformed correspondences (T0*x0, T1*x1)
+static Matx33d linearEpipolar(const Point2d *pts0, const Point2d *pts1, const int *idx, int n, const Matx33d &T0, const Matx33d &T1) {
+    
+    Matx<double,9,9> AtA;
+    for (int i = 0; i < n; i++) {
+        const Point2d &p0 = pts0[idx[i]], &p1 = pts1[idx[i]];
+        double x0 = T0(0,0)*p0.x + T0(0,1)*p0.y + T0(0,2), y0 = T0(1,0)*p0.x + T0(1,1)*p0.y + T0(1,2);
+        double x1 = T1(0,0)*p1.x + T1(0,1)*p1.y + T1(0,2), y1 = T1(1,0)*p1.x + T1(1,1)*p1.y + T1(1,2);
+        double r[9] = {x1*x0, x1*y0, x1, y1*x0, y1*y0, y1, x0, y0, 1};
+        accumulateRow(AtA, r);
+    }
+    symmetrise(AtA);
+    return nullVector(AtA);
+}
+
+int FundamentalSolver::fit(const Point2d *pts0, const Point2d *pts1, const int *idx, int n, Matx33d *models) const {
+    
+    Matx33d T0 = normalisingTransform(pts0, idx, n);
+    Matx33d T1 = normalisingTransform(pts1, idx, n);
+    Matx33d F = linearEpipolar(pts0, pts1, idx, n, T0, T1);
+    
+    //enforce rank 2
+    Matx31d w;
+    Matx33d u, vt;
+    SVD::compute(F, w, u, vt);
+    F = u*Matx33d(w(0), 0, 0, 0, w(1), 0, 0, 0, 0)*vt;
+    
+    //undo normalisation
+    F = T1.t()*F*T0;
+    if (fabs(F(2,2)) > DBL_EPSILON)
+        F *= 1.0/F(2,2);
+    models[0] = F;
+    return 1;
+}
+
+void FundamentalSolver::residuals(const Matx33d &model, const Point2d *pts0, const Point2d *pts1, size_t n, double *res) const {
+    GeometryUtils::epipolarResiduals(model, pts0, pts1, n, res, NULL, DBL_MAX, GeometryUtils::EPIPOLAR_SAMPSON);
+}
+
+EssentialSolver::EssentialSolver(const Matx33d &K0, const Matx33d &K1) {
+    K0i = K0.inv();
+    K1i = K1.inv();
+}
+
+int EssentialSolver::fit(const Point2d *pts0, const Point2d *pts1, const int *idx, int n, Matx33d *models) const {
+    
+    Matx33d E = linearEpipolar(pts0, pts1, idx, n, K0i, K1i);
+    
+    //project onto the essential manifold: two equal singular values and a zero one
+    Matx31d w;
+    Matx33d u, vt;
+    SVD::compute(E, w, u, vt);
+    E = u*Matx33d(1, 0, 0, 0, 1, 0, 0, 0, 0)*vt;
+    models[0] = E;
+    return 1;
+}
+
+void EssentialSolver::residuals(const Matx33d &model, const Point2d *pts0, const Point2d *pts1, size_t n, double *res) const {
+    //score in pixels through the corresponding fundamental matrix
+    Matx33d F = K1i.t()*model*K0i;
+    GeometryUtils::epipolarResiduals(F, pts0, pts1, n, res, NULL, DBL_MAX, GeometryUtils::EPIPOLAR_SAMPSON);
+}
+
+int FivePointSolver::fit(const Point2d *pts0, const Point2d *pts1, const int *idx, int n, Matx33d *models) const {
+    
+    if (n >= 8)
+        return EssentialSolver::fit(pts0, pts1, idx, n, models);
+    
+    Point2d x0[5], x1[5];
+    for (int i = 0; i < 5; i++) {
+        const Point2d &p0 = pts0[idx[i]], &p1 = pts1[idx[i]];
+        x0[i] = Point2d(K0i(0,0)*p0.x + K0i(0,1)*p0.y + K0i(0,2), K0i(1,1)*p0.y + K0i(1,2));
+        x1[i] = Point2d(K1i(0,0)*p1.x + K1i(0,1)*p1.y + K1i(0,2), K1i(1,1)*p1.y + K1i(1,2));
+    }
+    return GeometryUtils::essentialFromFivePoints(x0, x1, models);
+}
+
+int HomographySolver::fit(const Point2d *pts0, const Point2d *pts1, const int *idx, int n, Matx33d *models) const {
+    
+    Matx33d T0 = normalisingTransform(pts0, idx, n);
+    Matx33d T1 = normalisingTransform(pts1, idx, n);
+    
+    //DLT: two equations per correspondence x1 ~ H*x0
+    Matx<double,9,9> AtA;
+    for (int i = 0; i < n; i++) {
+        const Point2d &p0 = pts0[idx[i]], &p1 = pts1[idx[i]];
+        double x0 = T0(0,0)*p0.x + T0(0,2), y0 = T0(1,1)*p0.y + T0(1,2);
+        double x1 = T1(0,0)*p1.x + T1(0,2), y1 = T1(1,1)*p1.y + T1(1,2);
+        double r0[9] = {0, 0, 0, -x0, -y0, -1, y1*x0, y1*y0, y1};
+        double r1[9] = {x0, y0, 1, 0, 0, 0, -x1*x0, -x1*y0, -x1};
+        accumulateRow(AtA, r0);
+        accumulateRow(AtA, r1);
+    }
+    symmetrise(AtA);
+    
+    //undo normalisation
+    Matx33d H = T1.inv()*nullVector(AtA)*T0;
+    if (fabs(H(2,2)) > DBL_EPSILON)
+        H *= 1.0/H(2,2);
+    models[0] = H;
+    return 1;
+}
+
+void HomographySolver::residuals(const Matx33d &model, const Point2d *pts0, const Point2d *pts1, size_t n, double *res) const {
+    GeometryUtils::homographyResiduals(model, pts0, pts1, n, res);
+    for (size_t i = 0; i < n; i++)
+        res[i] *= 0.5;
+}
+
+int RobustEstimator::requiredIterations(double inlierRatio, int sampleSize, double confidence, int maxIterations) {
+    
+    double pGood = pow(inlierRatio, sampleSize);
+    if (pGood <= DBL_EPSILON)
+        return maxIterations;
+    if (pGood >= 1.0)
+        return 1;
+    double k = log(1.0 - confidence)/log(1.0 - pGood);
+    return (k < maxIterations) ? max((int)ceil(k), 1) : maxIterations;
+}
+
+double RobustEstimator::sprtThreshold(double epsilon, double delta, double modelCost, double modelsPerSample) {
+    
+    //the test is meaningless if bad models are as consistent as good ones
+    if (epsilon <= delta)
+        return DBL_MAX;
+    
+    //optimal threshold from Matas and Chum, "Randomized RANSAC with sequential probability ratio test"
+    double C = (1 - delta)*log((1 - delta)/(1 - epsilon)) + delta*log(delta/epsilon);
+    double A0 = modelCost*C/modelsPerSample + 1;
+    double A = A0;
+    for (int i = 0; i < 10; i++)
+        A = A0 + log(A);
+    return A;
+}
+
+bool RobustEstimator::verify(const MinimalSolver &solver, const Matx33d &model, const vector<Point2d> &pts0, const vector<Point2d> &pts1, double thrSq, bool sprt, double epsilon, double delta, double A, int &nInliers, int &nChecked, double *res) {
+    
+    double lambdaIn = delta/epsilon, lambdaOut = (1 - delta)/(1 - epsilon);
+    double lambda = 1;
+    int n = (int)pts0.size();
+    nInliers = 0;
+    nChecked = 0;
+    for (int b = 0; b < n; b += kVerifyBlock) {
+        int m = min(kVerifyBlock, n - b);
+        solver.residuals(model, &pts0[b], &pts1[b], m, res);
+        for (int i = 0; i < m; i++) {
+            bool inlier = res[i] < thrSq;
+            nInliers += inlier;
+            lambda *= inlier ? lambdaIn : lambdaOut;
+        }
+        nChecked += m;
+        
+        //likelihood ratio says bad model
+        if (sprt && (lambda > A))
+            return false;
+    }
+    return true;
+}
+
+//draws n distinct indices from [begin, end)
+static void drawSample(RNG &rng, int *sample, int n, int begin, int end) {
+    for (int i = 0; i < n; i++) {
+        bool unique;
+        do {
+            sample[i] = rng.uniform(begin, end);
+            unique = true;
+            for (int j = 0; j < i; j++)
+                unique = unique && (sample[j] != sample[i]);
+        } while (!unique);
+    }
+}
+
+bool RobustEstimator::estimate(const MinimalSolver &solver, const vector<Point2d> &pts0, const vector<Point2d> &pts1, RobustResult &result, const RobustParams &params, const vector<double> &scores) {
+    
+    int n = (int)pts0.size();
+    int m = solver.sampleSize();
+    result = RobustResult();
+    result.inliers.assign(n, 0);
+    if (n < m)
+        return false;
+    
+    //work on a copy ordered by decreasing score for PROSAC, or randomly so the SPRT sees unbiased blocks
+    RNG rng(params.seed);
+    bool prosac = (scores.size() == (size_t)n);
+    vector<int> order(n);
+    if (prosac) {
+        vector<size_t> idx = VectorUtils::sort_indexes(scores);
+        for (int i = 0; i < n; i++)
+            order[i] = (int)idx[n - 1 - i];
+    }
+    else {
+        iota(order.begin(), order.end(), 0);
+        for (int i = n - 1; i > 0; i--)
+            swap(order[i], order[rng.uniform(0, i + 1)]);
+    }
+    vector<Point2d> p0(n), p1(n);
+    for (int i = 0; i < n; i++) {
+        p0[i] = pts0[order[i]];
+        p1[i] = pts1[order[i]];
+    }
+    
+    double thrSq = params.threshold*params.threshold;
+    vector<int> sample(m);
+    vector<Matx33d> models(solver.maxModels());
+    double res[kVerifyBlock];
+    
+    //SPRT state
+    double epsilon = params.sprtEpsilon, delta = params.sprtDelta;
+    double A = sprtThreshold(epsilon, delta, params.sprtModelCost, 1);
+    double deltaSum = 0;
+    long totalModels = 0;
+    
+    //PROSAC state: samples are drawn from the best `subset` correspondences and always contain the newest one
+    int subset = m;
+    double Tn = kProsacTN;
+    for (int i = 0; i < m; i++)
+        Tn *= (double)(subset - i)/(n - i);
+    long TnPrime = 1;
+    
+    int bestInliers = 0;
+    Matx33d bestModel;
+    int maxIterations = params.maxIterations;
+    int it = 0;
+    while (it < maxIterations) {
+        it++;
+        
+        //draw sample
+        if (prosac) {
+            if ((it == TnPrime) && (subset < n)) {
+                double Tn1 = Tn*(subset + 1)/(subset + 1 - m);
+                TnPrime += (long)ceil(Tn1 - Tn);
+                Tn = Tn1;
+                subset++;
+            }
+            if (TnPrime < it)
+                drawSample(rng, &sample[0], m, 0, subset);
+            else {
+                drawSample(rng, &sample[0], m - 1, 0, subset - 1);
+                sample[m - 1] = subset - 1;
+            }
+        }
+        else
+            drawSample(rng, &sample[0], m, 0, n);
+        
+        //hypothesize
+        int nModels = solver.fit(&p0[0], &p1[0], &sample[0], m, &models[0]);
+        totalModels += nModels;
+        
+        //verify
+        for (int k = 0; k < nModels; k++) {
+            int nInliers, nChecked;
+            if (!verify(solver, models[k], p0, p1, thrSq, params.sprt, epsilon, delta, A, nInliers, nChecked, res)) {
+                //update the estimate of the consistency of bad models
+                result.rejected++;
+                deltaSum += (double)nInliers/nChecked;
+                delta = max(deltaSum/result.rejected, 1e-4);
+                A = sprtThreshold(epsilon, delta, params.sprtModelCost, (double)totalModels/it);
+                continue;
+            }
+            
+            //save best model and update termination criteria
+            if (nInliers > bestInliers) {
+                bestInliers = nInliers;
+                bestModel = models[k];
+                epsilon = (double)bestInliers/n;
+                A = sprtThreshold(epsilon, delta, params.sprtModelCost, (double)totalModels/it);
+                maxIterations = min(maxIterations, requiredIterations(epsilon, m, params.confidence, params.maxIterations));
+            }
+        }
+    }
+    result.iterations = it;
+    
+    if (bestInliers < m) {
+        cerr << "No model with enough inliers" << endl;
+        return false;
+    }
+    
+    //refit on all inliers and keep the refined model if it does not lose support
+    vector<int> inlierIdx;
+    inlierIdx.reserve(bestInliers);
+    for (int b = 0; b < n; b += kVerifyBlock) {
+        int mb = min(kVerifyBlock, n - b);
+        solver.residuals(bestModel, &p0[b], &p1[b], mb, res);
+        for (int i = 0; i < mb; i++) {
+            if (res[i] < thrSq)
+                inlierIdx.push_back(b + i);
+        }
+    }
+    int nRefit = solver.fit(&p0[0], &p1[0], &inlierIdx[0], (int)inlierIdx.size(), &models[0]);
+    for (int k = 0; k < nRefit; k++) {
+        int nInliers, nChecked;
+        verify(solver, models[k], p0, p1, thrSq, false, epsilon, delta, A, nInliers, nChecked, res);
+        if (nInliers >= bestInliers) {
+            bestInliers = nInliers;
+            bestModel = models[k];
+        }
+    }
+    
+    //inlier mask in input order
+    for (int b = 0; b < n; b += kVerifyBlock) {
+        int mb = min(kVerifyBlock, n - b);
+        solver.residuals(bestModel, &p0[b], &p1[b], mb, res);
+        for (int i = 0; i < mb; i++)
+            result.inliers[order[b + i]] = res[i] < thrSq;
+    }
+    result.model = bestModel;
+    result.nInliers = bestInliers;
+    
+    return true;
+}
+
+bool RobustEstimator::estimate(const MinimalSolver &solver, const vector<Point2f> &pts0, const vector<Point2f> &pts1, RobustResult &result, const RobustParams &params, const vector<double> &scores) {
+    
+    vector<Point2d> p0(pts0.begin(), pts0.end()), p1(pts1.begin(), pts1.end());
+    return estimate(solver, p0, p1, result, params, scores);
+}
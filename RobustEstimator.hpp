@@ -0,0 +1,135 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef RobustEstimator_hpp
+#define RobustEstimator_hpp
+
+#include <stdio.h>
+#include "GeometryUtils.hpp"
+
+using namespace std;
+using namespace cv;
+
+//Minimal solver plugged into RobustEstimator. Models are 3x3 matrices relating view 0 to view 1 (F, E or H)
+class MinimalSolver {
+    
+public:
+    virtual ~MinimalSolver() {}
+    
+    //number of correspondences in a minimal sample
+    virtual int sampleSize() const = 0;
+    
+    //maximum number of models returned by fit
+    virtual int maxModels() const { return 1; }
+    
+    //fits models to the n >= sampleSize() correspondences pts0[idx[i]] <-> pts1[idx[i]], returns the number of models written
+    virtual int fit(const Point2d *pts0, const Point2d *pts1, const int *idx, int n, Matx33d *models) const = 0;
+    
+    //squared pixel residual of each of the n correspondences under model
+    virtual void residuals(const Matx33d &model, const Point2d *pts0, const Point2d *pts1, size_t n, double *res) const = 0;
+};
+
+//normalised 8-point fundamental matrix, scored with the Sampson distance
+class FundamentalSolver : public MinimalSolver {
+    
+public:
+    int sampleSize() const { return 8; }
+    int fit(const Point2d *pts0, const Point2d *pts1, const int *idx, int n, Matx33d *models) const;
+    void residuals(const Matx33d &model, const Point2d *pts0, const Point2d *pts1, size_t n, double *res) const;
+};
+
+//linear 8-point essential matrix on coordinates normalised with K0/K1, scored with the Sampson distance in pixels
+class EssentialSolver : public MinimalSolver {
+    
+public:
+    EssentialSolver(const Matx33d &K0, const Matx33d &K1);
+    int sampleSize() const { return 8; }
+    int fit(const Point2d *pts0, const Point2d *pts1, const int *idx, int n, Matx33d *models) const;
+    void residuals(const Matx33d &model, const Point2d *pts0, const Point2d *pts1, size_t n, double *res) const;
+    
+protected:
+    Matx33d K0i, K1i;
+};
+
+//five-point essential matrix on coordinates normalised with K0/K1, up to 10 models per sample. Fits to 8 or more correspondences
+//(the final refit on the inliers) fall back to the linear 8-point solver
+class FivePointSolver : public EssentialSolver {
+    
+public:
+    FivePointSolver(const Matx33d &K0, const Matx33d &K1) : EssentialSolver(K0, K1) {}
+    int sampleSize() const { return 5; }
+    int maxModels() const { return 10; }
+    int fit(const Point2d *pts0, const Point2d *pts1, const int *idx, int n, Matx33d *models) const;
+};
+
+//normalised 4-point homography, scored with the mean of the squared forward and backward transfer errors
+class HomographySolver : public MinimalSolver {
+    
+public:
+    int sampleSize() const { return 4; }
+    int fit(const Point2d *pts0, const Point2d *pts1, const int *idx, int n, Matx33d *models) const;
+    void residuals(const Matx33d &model, const Point2d *pts0, const Point2d *pts1, size_t n, double *res) const;
+};
+
+struct RobustParams {
+    double threshold = 1.0;         //inlier threshold in pixels
+    double confidence = 0.99;       //probability of having drawn an all-inlier sample when stopping
+    int maxIterations = 2000;
+    bool sprt = true;               //early rejection of bad models with Wald's sequential probability ratio test
+    double sprtEpsilon = 0.1;       //initial estimate of the inlier ratio
+    double sprtDelta = 0.05;        //initial probability that a correspondence is consistent with a bad model
+    double sprtModelCost = 200;     //cost of fitting a sample, in units of the verification of one correspondence
+    uint64 seed = 0x5eed;           //random seed, the result is deterministic for a given seed
+};
+
+struct RobustResult {
+    Matx33d model;
+    vector<uchar> inliers;          //1 for inliers, in the order of the input correspondences
+    int nInliers = 0;
+    int iterations = 0;             //number of samples drawn
+    int rejected = 0;               //number of models rejected early by the SPRT
+};
+
+class RobustEstimator {
+    
+public:
+    
+    //Hypothesize-and-verify estimation of the model of solver. Models are verified with the solver's batch residuals in blocks, and
+    //the SPRT abandons a model as soon as it is unlikely to beat the best one. If scores (higher is better) are given, samples are
+    //drawn PROSAC style from progressively larger sets of the best scored correspondences. The best model is refit on its inliers.
+    //Returns false if no model with at least sampleSize() inliers was found
+    static bool estimate(const MinimalSolver &solver, const vector<Point2d> &pts0, const vector<Point2d> &pts1, RobustResult &result, const RobustParams &params = RobustParams(), const vector<double> &scores = vector<double>());
+    static bool estimate(const MinimalSolver &solver, const vector<Point2f> &pts0, const vector<Point2f> &pts1, RobustResult &result, const RobustParams &params = RobustParams(), const vector<double> &scores = vector<double>());
+    
+    //number of samples needed to draw an all-inlier sample with the given confidence
+    static int requiredIterations(double inlierRatio, int sampleSize, double confidence, int maxIterations);
+    
+private:
+    
+    //SPRT decision threshold for the current inlier ratio and bad-model consistency estimates
+    static double sprtThreshold(double epsilon, double delta, double modelCost, double modelsPerSample);
+    
+    //scores model block by block, counting inliers among the nChecked correspondences checked. Returns false if the SPRT rejected it
+    static bool verify(const MinimalSolver &solver, const Matx33d &model, const vector<Point2d> &pts0, const vector<Point2d> &pts1, double thrSq, bool sprt, double epsilon, double delta, double A, int &nInliers, int &nChecked, double *res);
+};
+
+#endif /* RobustEstimator_hpp */
@@ -0,0 +1,60 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef TrackTable_hpp
+#define TrackTable_hpp
+
+#include <stdio.h>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+//Observations of a set of tracks (3D points seen in several views) in compressed row layout: the observations of track i are
+//[start[i], start[i+1]) of view and pts, view[k] indexing the camera array the table is used with and pts[k] being in pixels
+struct TrackTable {
+    vector<int> start;
+    vector<int> view;
+    vector<Point2d> pts;
+    
+    TrackTable() : start(1, 0) {}
+    
+    size_t size() const { return start.size() - 1; }
+    bool empty() const { return start.size() == 1; }
+    size_t nObservations() const { return view.size(); }
+    int length(size_t i) const { return start[i + 1] - start[i]; }
+    
+    //observations are added to the current track until endTrack closes it
+    void addObservation(int v, const Point2d &pt) {
+        view.push_back(v);
+        pts.push_back(pt);
+    }
+    void endTrack() { start.push_back((int)view.size()); }
+    
+    void clear() {
+        start.assign(1, 0);
+        view.clear();
+        pts.clear();
+    }
+};
+
+#endif /* TrackTable_hpp */
@@ -28,25 +28,593 @@
 #include <vector>
 #include <algorithm>
 #include <numeric>
+#include <iterator>
+#include <string.h>
+#include <stdint.h>
+#include <type_traits>
+#include "ParallelUtils.hpp"
 
 using namespace std;
 
+//unsigned integer of the size of the values sorted by VectorUtils::radix_sort_indexes
+template <size_t bytes> struct RadixKeyType;
+template <> struct RadixKeyType<1> { typedef uint8_t type; };
+template <> struct RadixKeyType<2> { typedef uint16_t type; };
+template <> struct RadixKeyType<4> { typedef uint32_t type; };
+template <> struct RadixKeyType<8> { typedef uint64_t type; };
+
+//Element of each array permuted by VectorUtils::reorder_arrays, recursively over the arrays: the element carried along a cycle and
+//the buffer of the blocked version
+template <typename... value_iterators>
+struct PermutationCursor {
+    static const size_t bytes = 0;
+    void load(size_t) {}
+    void exchange(size_t) {}
+    void store(size_t) {}
+    void allocate(size_t) {}
+    template <typename order_iterator>
+    void scatter(order_iterator, size_t, size_t) {}
+    void moveBack(size_t) {}
+};
+
+template <typename value_iterator, typename... value_iterators>
+struct PermutationCursor<value_iterator, value_iterators...> {
+    
+    typedef typename iterator_traits<value_iterator>::value_type value_t;
+    value_iterator v;
+    value_t carried;
+    vector<value_t> buffer;
+    PermutationCursor<value_iterators...> rest;
+    
+    //size of one element of every array
+    static const size_t bytes = sizeof(value_t) + PermutationCursor<value_iterators...>::bytes;
+    
+    PermutationCursor(value_iterator v, value_iterators... rest) : v(v), rest(rest...) {}
+    
+    void load(size_t i) {
+        carried = std::move(v[i]);
+        rest.load(i);
+    }
+    void exchange(size_t i) {
+        swap(carried, v[i]);
+        rest.exchange(i);
+    }
+    void store(size_t i) {
+        v[i] = std::move(carried);
+        rest.store(i);
+    }
+    
+    void allocate(size_t n) {
+        buffer.resize(n);
+        rest.allocate(n);
+    }
+    template <typename order_iterator>
+    void scatter(order_iterator order, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            buffer[order[i]] = std::move(v[i]);
+        rest.scatter(order, begin, end);
+    }
+    void moveBack(size_t n) {
+        std::move(buffer.begin(), buffer.begin() + n, v);
+        rest.moveBack(n);
+    }
+};
+
+//Element of each array compacted by VectorUtils::compact, recursively over the arrays
+template <typename... values>
+struct CompactionCursor {
+    void move(size_t, size_t) {}
+    void truncate(size_t) {}
+    void allocate(size_t) {}
+    void gather(const size_t *, size_t, size_t) {}
+    void swapBuffers() {}
+};
+
+template <typename value_t, typename... values>
+struct CompactionCursor<value_t, values...> {
+    
+    vector<value_t> &v;
+    vector<value_t> buffer;
+    CompactionCursor<values...> rest;
+    
+    CompactionCursor(vector<value_t> &v, vector<values> &... rest) : v(v), rest(rest...) {}
+    
+    //from element i to element j < i
+    void move(size_t j, size_t i) {
+        v[j] = std::move(v[i]);
+        rest.move(j, i);
+    }
+    void truncate(size_t n) {
+        v.erase(v.begin() + n, v.end());
+        rest.truncate(n);
+    }
+    
+    void allocate(size_t n) {
+        buffer.resize(n);
+        rest.allocate(n);
+    }
+    void gather(const size_t *idx, size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++)
+            buffer[k] = v[idx[k]];
+        rest.gather(idx, begin, end);
+    }
+    void swapBuffers() {
+        v.swap(buffer);
+        vector<value_t>().swap(buffer);
+        rest.swapBuffers();
+    }
+};
+
 class VectorUtils {
     
 public:
     
-    //sorts vector and returns vector with original position indices
-    static vector<size_t> sort_indexes(const vector<double> &v);
+    //sorts vector and returns vector with original position indices. Ties keep their original order
+    template <typename T>
+    static vector<size_t> sort_indexes(const vector<T> &v);
+    
+    //Argsort of arithmetic values by LSD radix sort of (key, index) pairs, the keys being the value bits mapped to unsigned integers
+    //of the same order (for floating point -0 sorts before +0 and NaNs of either sign last). Stable, linear time and without
+    //indirect loads into v
+    template <typename T>
+    static vector<size_t> radix_sort_indexes(const vector<T> &v);
+    
+    //radix sorted runs on nThreads threads, merged pairwise with every merge split across the threads along its merge path
+    template <typename T>
+    static vector<size_t> parallel_sort_indexes(const vector<T> &v, int nThreads);
     
-    //sorts vector according to vector of indices. The vector of indices is destroyed
+    //indices of the k smallest values, in increasing order if sorted is true, else in no particular order
+    template <typename T>
+    static vector<size_t> partial_sort_indexes(const vector<T> &v, size_t k, bool sorted = true);
+    
+    //sorts vector according to vector of indices, moving v[i] to position order[i]. The vector of indices is destroyed
     template< typename order_iterator, typename value_iterator >
     static void reorder_index_destructive( order_iterator order_begin, order_iterator order_end, value_iterator v);
     
-    //sorts vector according to vector of indices.
+    //sorts vector according to vector of indices, moving v[i] to position order[i]
     template< typename order_iterator, typename value_iterator >
-    void reorder_index( order_iterator order_begin, order_iterator order_end, value_iterator v);
+    static void reorder_index( order_iterator order_begin, order_iterator order_end, value_iterator v);
+    
+    //Moves v[i] to position order[i] in every array v (pts2D, pts3D, descriptors, status...) at once. Each cycle of the permutation
+    //is followed once, carrying one element of every array, with a flag per element instead of the search for cycle leaders of
+    //reorder_index. Large permutations of narrow elements go to reorder_arrays_blocked
+    template <typename order_iterator, typename... value_iterators>
+    static void reorder_arrays(order_iterator order_begin, order_iterator order_end, value_iterators... v);
+    
+    //out of place version of reorder_arrays: every block of the order is applied to all arrays while it is in cache, scattering into
+    //a buffer per array which is moved back at the end. Needs the memory of a copy of every array
+    template <typename order_iterator, typename... value_iterators>
+    static void reorder_arrays_blocked(order_iterator order_begin, order_iterator order_end, value_iterators... v);
+    
+    //inverse of a permutation, turning the result of the sort_indexes functions (position -> original index) into an order for
+    //reorder_arrays (original index -> position)
+    static vector<size_t> invert_permutation(const vector<size_t> &idx);
+    
+    //Keeps the elements i with mask[i] != 0 (the status of the GeometryUtils filters) of every array, in order, and returns how many
+    //were kept. Works in place without branching on the mask: every element is moved to the next free slot, which only advances
+    //for kept ones. The mask is read 8 bytes at a time to skip runs of discarded elements and the leading run of kept ones
+    template <typename... values>
+    static size_t compact(const vector<uint8_t> &mask, vector<values> &... arrays);
+    
+    //compact on nThreads threads for large inputs: survivors are counted per chunk, their original indices are written at the prefix
+    //sums of the counts, and every array is gathered through them into a new buffer. Returns the original indices of the survivors
+    template <typename... values>
+    static vector<size_t> compact_parallel(const vector<uint8_t> &mask, int nThreads, vector<values> &... arrays);
 
+private:
+    
+    template <typename K>
+    struct KeyIndex {
+        K key;
+        size_t index;
+        bool operator<(const KeyIndex &o) const { return (key < o.key) || ((key == o.key) && (index < o.index)); }
+    };
+    
+    //below this size the pairs are sorted with std::sort
+    static const size_t radixMinSize = 1024;
+    
+    //reorder_arrays switches to reorder_arrays_blocked from reorderBlockedMinSize elements if an element of every array is narrow, or
+    //if it is not too wide and the arrays are well beyond the cache. Otherwise chasing the cycles in place is faster
+    static const size_t reorderBlockedMinSize = 1 << 14;
+    static const size_t reorderBlockedNarrowBytes = 32;
+    static const size_t reorderBlockedWideBytes = 128;
+    static const size_t reorderBlockedMinMemory = 1 << 24;
+    static const size_t reorderBlockSize = 4096;
+    
+    //elements per chunk of compact_parallel
+    static const size_t compactChunkSize = 1 << 16;
     
+    //8 mask bytes, and the number of them that are nonzero
+    static uint64_t maskWord(const uint8_t *mask);
+    static size_t countNonZero(uint64_t word);
+    static size_t countNonZero(const uint8_t *mask, size_t n);
+    
+    template <typename T>
+    static typename RadixKeyType<sizeof(T)>::type radixKey(T value);
+    
+    template <typename T>
+    static void makeKeys(const vector<T> &v, vector<KeyIndex<typename RadixKeyType<sizeof(T)>::type> > &pairs);
+    
+    template <typename K>
+    static vector<size_t> indexes(const vector<KeyIndex<K> > &pairs);
+    
+    //sorts a[0, n) using tmp[0, n) as scratch
+    template <typename K>
+    static void radixSort(KeyIndex<K> *a, KeyIndex<K> *tmp, size_t n);
+    
+    //number of elements of a in the first diag outputs of the merge of a and b
+    template <typename K>
+    static size_t mergePath(const KeyIndex<K> *a, size_t na, const KeyIndex<K> *b, size_t nb, size_t diag);
 };
 
+template <typename T>
+typename RadixKeyType<sizeof(T)>::type VectorUtils::radixKey(T value) {
+    
+    static_assert(is_arithmetic<T>::value, "radix keys need arithmetic values");
+    typedef typename RadixKeyType<sizeof(T)>::type K;
+    const K sign = K(1) << (8*sizeof(T) - 1);
+    K u;
+    memcpy(&u, &value, sizeof(T));
+    
+    //negative floats have their order reversed, signed integers are offset by the sign bit. NaNs of either sign get the largest key
+    if (is_floating_point<T>::value) {
+        if (value != value)
+            return K(~K(0));
+        return (u & sign) ? K(~u) : K(u | sign);
+    }
+    if (is_signed<T>::value)
+        return K(u ^ sign);
+    return u;
+}
+
+template <typename T>
+void VectorUtils::makeKeys(const vector<T> &v, vector<KeyIndex<typename RadixKeyType<sizeof(T)>::type> > &pairs) {
+    pairs.resize(v.size());
+    for (size_t i = 0; i < v.size(); i++) {
+        pairs[i].key = radixKey(v[i]);
+        pairs[i].index = i;
+    }
+}
+
+template <typename K>
+vector<size_t> VectorUtils::indexes(const vector<KeyIndex<K> > &pairs) {
+    vector<size_t> idx(pairs.size());
+    for (size_t i = 0; i < pairs.size(); i++)
+        idx[i] = pairs[i].index;
+    return idx;
+}
+
+template <typename K>
+void VectorUtils::radixSort(KeyIndex<K> *a, KeyIndex<K> *tmp, size_t n) {
+    
+    if (n < radixMinSize) {
+        sort(a, a + n);
+        return;
+    }
+    
+    //the fewest passes with digits of at most 13 bits (5 x 13 for 64-bit keys, 3 x 11 for 32-bit ones), with the histograms of all
+    //passes counted in one sweep
+    const int width = 8*sizeof(K), passes = (width + 12)/13, bits = (width + passes - 1)/passes, buckets = 1 << bits;
+    vector<size_t> hist(passes*buckets, 0);
+    for (size_t i = 0; i < n; i++) {
+        K key = a[i].key;
+        for (int p = 0; p < passes; p++)
+            hist[p*buckets + ((key >> (p*bits)) & (buckets - 1))]++;
+    }
+    
+    KeyIndex<K> *src = a, *dst = tmp;
+    for (int p = 0; p < passes; p++) {
+        size_t *h = &hist[p*buckets];
+        
+        //all keys share this digit
+        if (h[(src[0].key >> (p*bits)) & (buckets - 1)] == n)
+            continue;
+        
+        size_t offset = 0;
+        for (int d = 0; d < buckets; d++) {
+            size_t count = h[d];
+            h[d] = offset;
+            offset += count;
+        }
+        for (size_t i = 0; i < n; i++)
+            dst[h[(src[i].key >> (p*bits)) & (buckets - 1)]++] = src[i];
+        swap(src, dst);
+    }
+    if (src != a)
+        copy(src, src + n, a);
+}
+
+template <typename K>
+size_t VectorUtils::mergePath(const KeyIndex<K> *a, size_t na, const KeyIndex<K> *b, size_t nb, size_t diag) {
+    size_t lo = (diag > nb) ? diag - nb : 0, hi = min(diag, na);
+    while (lo < hi) {
+        size_t mid = (lo + hi)/2;
+        if (a[mid] < b[diag - mid - 1])
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+template <typename T>
+vector<size_t> VectorUtils::sort_indexes(const vector<T> &v) {
+    
+    //(value, index) pairs keep the comparisons on contiguous data
+    vector<pair<T, size_t> > pairs(v.size());
+    for (size_t i = 0; i < v.size(); i++)
+        pairs[i] = make_pair(v[i], i);
+    sort(pairs.begin(), pairs.end());
+    
+    vector<size_t> idx(v.size());
+    for (size_t i = 0; i < v.size(); i++)
+        idx[i] = pairs[i].second;
+    return idx;
+}
+
+template <typename T>
+vector<size_t> VectorUtils::radix_sort_indexes(const vector<T> &v) {
+    
+    typedef typename RadixKeyType<sizeof(T)>::type K;
+    vector<KeyIndex<K> > pairs, tmp(v.size());
+    makeKeys(v, pairs);
+    if (!pairs.empty())
+        radixSort(&pairs[0], &tmp[0], pairs.size());
+    return indexes(pairs);
+}
+
+template <typename T>
+vector<size_t> VectorUtils::parallel_sort_indexes(const vector<T> &v, int nThreads) {
+    
+    typedef typename RadixKeyType<sizeof(T)>::type K;
+    size_t n = v.size();
+    int nRuns = (int)min((size_t)max(nThreads, 1), n/radixMinSize);
+    if (nRuns <= 1)
+        return radix_sort_indexes(v);
+    
+    vector<KeyIndex<K> > pairs(n), tmp(n);
+    KeyIndex<K> *src = &pairs[0], *dst = &tmp[0];
+    size_t runSize = (n + nRuns - 1)/nRuns;
+    ParallelUtils::parallelFor(n, runSize, nThreads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            src[i].key = radixKey(v[i]);
+            src[i].index = i;
+        }
+        radixSort(src + begin, dst + begin, end - begin);
+    });
+    
+    //merge rounds, each merge of a pair of runs split in segments so that all threads have work
+    for (size_t width = runSize; width < n; width *= 2) {
+        size_t nMerges = (n + 2*width - 1)/(2*width);
+        size_t nSegments = max((size_t)1, nThreads/nMerges);
+        ParallelUtils::parallelFor(nMerges*nSegments, 1, nThreads, [&](size_t begin, size_t end) {
+            for (size_t task = begin; task < end; task++) {
+                size_t lo = (task/nSegments)*2*width, s = task % nSegments;
+                size_t mid = min(lo + width, n), hi = min(lo + 2*width, n);
+                const KeyIndex<K> *a = src + lo, *b = src + mid;
+                size_t na = mid - lo, nb = hi - mid, total = na + nb;
+                size_t d0 = (total*s)/nSegments, d1 = (total*(s + 1))/nSegments;
+                size_t i0 = mergePath(a, na, b, nb, d0), i1 = mergePath(a, na, b, nb, d1);
+                merge(a + i0, a + i1, b + (d0 - i0), b + (d1 - i1), dst + lo + d0);
+            }
+        });
+        swap(src, dst);
+    }
+    
+    vector<size_t> idx(n);
+    for (size_t i = 0; i < n; i++)
+        idx[i] = src[i].index;
+    return idx;
+}
+
+template <typename T>
+vector<size_t> VectorUtils::partial_sort_indexes(const vector<T> &v, size_t k, bool sorted) {
+    
+    typedef typename RadixKeyType<sizeof(T)>::type K;
+    if (k >= v.size()) {
+        if (sorted)
+            return radix_sort_indexes(v);
+        vector<size_t> idx(v.size());
+        iota(idx.begin(), idx.end(), 0);
+        return idx;
+    }
+    
+    vector<KeyIndex<K> > pairs;
+    makeKeys(v, pairs);
+    nth_element(pairs.begin(), pairs.begin() + k, pairs.end());
+    pairs.resize(k);
+    if (sorted)
+        sort(pairs.begin(), pairs.end());
+    return indexes(pairs);
+}
+
+template< typename order_iterator, typename value_iterator >
+void VectorUtils::reorder_index_destructive( order_iterator order_begin, order_iterator order_end, value_iterator v )  {
+    typedef typename iterator_traits< value_iterator >::value_type value_t;
+    typedef typename iterator_traits< order_iterator >::value_type index_t;
+    typedef typename iterator_traits< order_iterator >::difference_type diff_t;
+    
+    diff_t remaining = order_end - 1 - order_begin;
+    for ( index_t s = index_t(); remaining > 0; ++ s ) {
+        index_t d = order_begin[s];
+        if ( d == (diff_t) -1 ) continue;
+        -- remaining;
+        value_t temp = v[s];
+        for ( index_t d2; d != s; d = d2 ) {
+            swap( temp, v[d] );
+            swap( order_begin[d], d2 = (diff_t) -1 );
+            -- remaining;
+        }
+        v[s] = temp;
+    }
+}
+
+template< typename order_iterator, typename value_iterator >
+void VectorUtils::reorder_index( order_iterator order_begin, order_iterator order_end, value_iterator v )  {
+    typedef typename iterator_traits< value_iterator >::value_type value_t;
+    typedef typename iterator_traits< order_iterator >::value_type index_t;
+    typedef typename iterator_traits< order_iterator >::difference_type diff_t;
+    
+    diff_t remaining = order_end - 1 - order_begin;
+    for ( index_t s = index_t(), d; remaining > 0; ++ s ) {
+        for ( d = order_begin[s]; d > s; d = order_begin[d] ) ;
+        if ( d == s ) {
+            -- remaining;
+            value_t temp = v[s];
+            while ( d = order_begin[d], d != s ) {
+                swap( temp, v[d] );
+                -- remaining;
+            }
+            v[s] = temp;
+        }
+    }
+}
+
+template <typename order_iterator, typename... value_iterators>
+void VectorUtils::reorder_arrays(order_iterator order_begin, order_iterator order_end, value_iterators... v) {
+    
+    size_t n = order_end - order_begin;
+    size_t bytes = PermutationCursor<value_iterators...>::bytes;
+    if ((n >= reorderBlockedMinSize) && ((bytes <= reorderBlockedNarrowBytes) || ((bytes <= reorderBlockedWideBytes) && (n*bytes >= reorderBlockedMinMemory)))) {
+        reorder_arrays_blocked(order_begin, order_end, v...);
+        return;
+    }
+    
+    PermutationCursor<value_iterators...> cursor(v...);
+    vector<uint8_t> done(n, 0);
+    for (size_t s = 0; s < n; s++) {
+        if (done[s])
+            continue;
+        done[s] = 1;
+        size_t d = order_begin[s];
+        if (d == s)
+            continue;
+        
+        //carry the elements of s along the cycle until it closes
+        cursor.load(s);
+        for (; d != s; d = order_begin[d]) {
+            cursor.exchange(d);
+            done[d] = 1;
+        }
+        cursor.store(s);
+    }
+}
+
+template <typename order_iterator, typename... value_iterators>
+void VectorUtils::reorder_arrays_blocked(order_iterator order_begin, order_iterator order_end, value_iterators... v) {
+    
+    size_t n = order_end - order_begin;
+    PermutationCursor<value_iterators...> cursor(v...);
+    cursor.allocate(n);
+    for (size_t begin = 0; begin < n; begin += reorderBlockSize)
+        cursor.scatter(order_begin, begin, min(begin + reorderBlockSize, n));
+    cursor.moveBack(n);
+}
+
+inline vector<size_t> VectorUtils::invert_permutation(const vector<size_t> &idx) {
+    vector<size_t> inverse(idx.size());
+    for (size_t i = 0; i < idx.size(); i++)
+        inverse[idx[i]] = i;
+    return inverse;
+}
+
+inline uint64_t VectorUtils::maskWord(const uint8_t *mask) {
+    uint64_t word;
+    memcpy(&word, mask, sizeof(word));
+    return word;
+}
+
+inline size_t VectorUtils::countNonZero(uint64_t word) {
+    
+    //fold every byte onto its lowest bit, then add the bytes up with a multiplication
+    word |= word >> 4;
+    word |= word >> 2;
+    word |= word >> 1;
+    word &= 0x0101010101010101ull;
+    return (size_t)((word*0x0101010101010101ull) >> 56);
+}
+
+inline size_t VectorUtils::countNonZero(const uint8_t *mask, size_t n) {
+    size_t count = 0, i = 0;
+    for (; i + 8 <= n; i += 8)
+        count += countNonZero(maskWord(mask + i));
+    for (; i < n; i++)
+        count += (mask[i] != 0);
+    return count;
+}
+
+template <typename... values>
+size_t VectorUtils::compact(const vector<uint8_t> &mask, vector<values> &... arrays) {
+    
+    const uint8_t *m = mask.data();
+    size_t n = mask.size(), i = 0;
+    
+    //leading kept elements stay where they are, a word without zero bytes being all kept
+    const uint64_t ones = 0x0101010101010101ull, highs = 0x8080808080808080ull;
+    while (i + 8 <= n) {
+        uint64_t w = maskWord(m + i);
+        if (((w - ones) & ~w & highs) != 0)
+            break;
+        i += 8;
+    }
+    while ((i < n) && m[i])
+        i++;
+    
+    //from here on j < i, so every element can be moved unconditionally
+    CompactionCursor<values...> cursor(arrays...);
+    size_t j = i;
+    while (i < n) {
+        if ((i + 8 <= n) && (maskWord(m + i) == 0)) {
+            i += 8;
+            continue;
+        }
+        size_t end = min(i + 8, n);
+        for (; i < end; i++) {
+            cursor.move(j, i);
+            j += (m[i] != 0);
+        }
+    }
+    cursor.truncate(j);
+    return j;
+}
+
+template <typename... values>
+vector<size_t> VectorUtils::compact_parallel(const vector<uint8_t> &mask, int nThreads, vector<values> &... arrays) {
+    
+    const uint8_t *m = mask.data();
+    size_t n = mask.size(), nChunks = (n + compactChunkSize - 1)/compactChunkSize;
+    vector<size_t> offsets(nChunks + 1, 0);
+    ParallelUtils::parallelFor(nChunks, 1, nThreads, [&](size_t cBegin, size_t cEnd) {
+        for (size_t c = cBegin; c < cEnd; c++) {
+            size_t begin = c*compactChunkSize;
+            offsets[c + 1] = countNonZero(m + begin, min(begin + compactChunkSize, n) - begin);
+        }
+    });
+    for (size_t c = 0; c < nChunks; c++)
+        offsets[c + 1] += offsets[c];
+    
+    //branchless index writes, stopping at the last survivor of the chunk so as not to write into the next chunk's range
+    vector<size_t> kept(offsets[nChunks]);
+    ParallelUtils::parallelFor(nChunks, 1, nThreads, [&](size_t cBegin, size_t cEnd) {
+        for (size_t c = cBegin; c < cEnd; c++) {
+            size_t begin = c*compactChunkSize, end = min(begin + compactChunkSize, n);
+            while ((end > begin) && !m[end - 1])
+                end--;
+            size_t *out = kept.data() + offsets[c];
+            for (size_t i = begin, j = 0; i < end; i++) {
+                out[j] = i;
+                j += (m[i] != 0);
+            }
+        }
+    });
+    
+    CompactionCursor<values...> cursor(arrays...);
+    cursor.allocate(kept.size());
+    ParallelUtils::parallelFor(kept.size(), compactChunkSize, nThreads, [&](size_t begin, size_t end) {
+        cursor.gather(kept.data(), begin, end);
+    });
+    cursor.swapBuffers();
+    return kept;
+}
+
 #endif /* VectorUtils_hpp */
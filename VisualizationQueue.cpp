@@ -0,0 +1,195 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#include "VisualizationQueue.hpp"
+#include <chrono>
+
+//worker sleep when the queue is empty
+static const int kIdleMicroseconds = 200;
+
+VisualizationQueue::VisualizationQueue(const Sink &sink, int capacity, float scale) : head(0), tail(0), pushed(0), dropped(0), rendered(0), running(true), drainOnStop(true), sink(sink), scale(scale) {
+    
+    uint64 size = 1;
+    while (size < (uint64)max(capacity, 1))
+        size <<= 1;
+    slots.resize(size);
+    mask = size - 1;
+    worker = thread(&VisualizationQueue::run, this);
+}
+
+VisualizationQueue::~VisualizationQueue() {
+    stop();
+}
+
+VisualizationFrame *VisualizationQueue::beginPush() {
+    
+    uint64 t = tail.load(memory_order_relaxed);
+    uint64 index = pushed.fetch_add(1, memory_order_relaxed);
+    if (!running.load(memory_order_relaxed) || (t - head.load(memory_order_acquire) > mask)) {
+        dropped.fetch_add(1, memory_order_relaxed);
+        return NULL;
+    }
+    
+    VisualizationFrame *frame = &slots[t & mask];
+    frame->index = index;
+    return frame;
+}
+
+void VisualizationQueue::commitPush() {
+    tail.store(tail.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+template <typename T>
+static inline void copyPoints(const vector<Point_<T> > &src, vector<Point2d> &dst) {
+    dst.resize(src.size());
+    for (size_t i = 0; i < src.size(); i++)
+        dst[i] = Point2d(src[i].x, src[i].y);
+}
+
+template <typename T>
+static bool pushFeaturesImpl(VisualizationQueue &queue, const Mat &img, const vector<Point_<T> > &pts, const Matx34d &P) {
+    
+    VisualizationFrame *frame = queue.beginPush();
+    if (frame == NULL)
+        return false;
+    frame->type = VisualizationFrame::FEATURES;
+    frame->img0 = img;
+    frame->img1 = Mat();
+    copyPoints(pts, frame->pts0);
+    frame->pts1.clear();
+    frame->P = P;
+    queue.commitPush();
+    return true;
+}
+
+template <typename T>
+static bool pushMatchesImpl(VisualizationQueue &queue, const Mat &img0, const Mat &img1, const vector<Point_<T> > &pts0, const vector<Point_<T> > &pts1, const Matx34d &P) {
+    
+    VisualizationFrame *frame = queue.beginPush();
+    if (frame == NULL)
+        return false;
+    frame->type = VisualizationFrame::MATCHES;
+    frame->img0 = img0;
+    frame->img1 = img1;
+    copyPoints(pts0, frame->pts0);
+    copyPoints(pts1, frame->pts1);
+    frame->P = P;
+    queue.commitPush();
+    return true;
+}
+
+bool VisualizationQueue::pushFeatures(const Mat &img, const vector<Point2d> &pts, const Matx34d &P) {
+    return pushFeaturesImpl(*this, img, pts, P);
+}
+
+bool VisualizationQueue::pushFeatures(const Mat &img, const vector<Point2f> &pts, const Matx34d &P) {
+    return pushFeaturesImpl(*this, img, pts, P);
+}
+
+bool VisualizationQueue::pushMatches(const Mat &img0, const Mat &img1, const vector<Point2d> &pts0, const vector<Point2d> &pts1, const Matx34d &P) {
+    return pushMatchesImpl(*this, img0, img1, pts0, pts1, P);
+}
+
+bool VisualizationQueue::pushMatches(const Mat &img0, const Mat &img1, const vector<Point2f> &pts0, const vector<Point2f> &pts1, const Matx34d &P) {
+    return pushMatchesImpl(*this, img0, img1, pts0, pts1, P);
+}
+
+bool VisualizationQueue::pushEpipolarLines(const Mat &img0, const Mat &img1, const Matx33d &F, const vector<Point2d> &pts, int pts0or1, int nFeatures, const Matx34d &P) {
+    
+    VisualizationFrame *frame = beginPush();
+    if (frame == NULL)
+        return false;
+    frame->type = VisualizationFrame::EPIPOLAR_LINES;
+    frame->img0 = img0;
+    frame->img1 = img1;
+    frame->pts0.assign(pts.begin(), pts.end());
+    frame->pts1.clear();
+    frame->F = F;
+    frame->pts0or1 = pts0or1;
+    frame->nFeatures = nFeatures;
+    frame->P = P;
+    commitPush();
+    return true;
+}
+
+void VisualizationQueue::stop(bool drain) {
+    
+    drainOnStop = drain;
+    running = false;
+    if (worker.joinable())
+        worker.join();
+}
+
+VisualizationStats VisualizationQueue::stats() const {
+    
+    VisualizationStats s;
+    s.pushed = pushed.load();
+    s.dropped = dropped.load();
+    s.rendered = rendered.load();
+    return s;
+}
+
+void VisualizationQueue::render(const VisualizationFrame &frame, Mat &canvas, float scale) {
+    
+    Mat view0, view1;
+    switch (frame.type) {
+        case VisualizationFrame::FEATURES:
+            Display2D::prepareCanvas(frame.img0, canvas, scale);
+            Display2D::renderFeatures(canvas, frame.pts0, scale);
+            break;
+        case VisualizationFrame::MATCHES:
+            Display2D::prepareCanvas(frame.img0, frame.img1, canvas, view0, view1, scale);
+            Display2D::renderMatches(canvas, frame.pts0, frame.pts1, frame.img0.cols, scale);
+            break;
+        case VisualizationFrame::EPIPOLAR_LINES:
+            Display2D::prepareCanvas(frame.img0, frame.img1, canvas, view0, view1, scale);
+            Display2D::renderEpipolarLines(view0, view1, frame.F, frame.pts0, frame.pts0or1, frame.nFeatures, scale);
+            break;
+    }
+}
+
+void VisualizationQueue::run() {
+    
+    Mat canvas;
+    while (true) {
+        uint64 h = head.load(memory_order_relaxed);
+        if (!running.load(memory_order_acquire) && !drainOnStop.load(memory_order_relaxed))
+            break;
+        if (h == tail.load(memory_order_acquire)) {
+            if (!running.load(memory_order_acquire) && (h == tail.load(memory_order_acquire)))
+                break;
+            this_thread::sleep_for(chrono::microseconds(kIdleMicroseconds));
+            continue;
+        }
+        
+        VisualizationFrame &frame = slots[h & mask];
+        render(frame, canvas, scale);
+        if (sink)
+            sink(canvas, frame);
+        
+        //let go of the producer's images before handing the slot back
+        frame.img0.release();
+        frame.img1.release();
+        head.store(h + 1, memory_order_release);
+        rendered.fetch_add(1, memory_order_relaxed);
+    }
+}
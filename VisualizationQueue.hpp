@@ -0,0 +1,103 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef VisualizationQueue_hpp
+#define VisualizationQueue_hpp
+
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include "Display2D.hpp"
+
+using namespace std;
+using namespace cv;
+
+//Snapshot of what a tracking thread wants to see. Images are shared, not copied, so the producer must not write into them after
+//pushing (pass freshly captured frames or clones)
+struct VisualizationFrame {
+    enum Type { FEATURES, MATCHES, EPIPOLAR_LINES };
+    Type type;
+    uint64 index;                   //sequence number of the push, dropped frames included
+    Mat img0, img1;
+    vector<Point2d> pts0, pts1;     //features of img0 and, for matches, of img1
+    Matx33d F;
+    int pts0or1, nFeatures;         //as in Display2D::displayEpipolarLines
+    Matx34d P;                      //camera pose, passed through to the sink
+};
+
+struct VisualizationStats {
+    uint64 pushed = 0;
+    uint64 dropped = 0;             //pushes refused because the queue was full
+    uint64 rendered = 0;
+};
+
+//Bounded lock-free single producer, single consumer queue of frames rendered with Display2D on a worker thread. Pushing copies the
+//points into a preallocated slot and never blocks: when the worker falls behind, new frames are dropped and counted
+class VisualizationQueue {
+    
+public:
+    
+    //called on the worker thread with each rendered canvas, which is reused for the next frame
+    typedef function<void(const Mat &canvas, const VisualizationFrame &frame)> Sink;
+    
+    //capacity is rounded up to a power of two
+    VisualizationQueue(const Sink &sink, int capacity = 4, float scale = 0.5);
+    ~VisualizationQueue();
+    
+    //Producer side, from a single thread. beginPush returns the slot to fill (its vectors keep their memory across frames) or
+    //NULL if the queue is full, then commitPush hands the filled slot to the worker
+    VisualizationFrame *beginPush();
+    void commitPush();
+    
+    //beginPush, fill, commitPush. Return false if the frame was dropped
+    bool pushFeatures(const Mat &img, const vector<Point2d> &pts, const Matx34d &P = Matx34d::eye());
+    bool pushFeatures(const Mat &img, const vector<Point2f> &pts, const Matx34d &P = Matx34d::eye());
+    bool pushMatches(const Mat &img0, const Mat &img1, const vector<Point2d> &pts0, const vector<Point2d> &pts1, const Matx34d &P = Matx34d::eye());
+    bool pushMatches(const Mat &img0, const Mat &img1, const vector<Point2f> &pts0, const vector<Point2f> &pts1, const Matx34d &P = Matx34d::eye());
+    bool pushEpipolarLines(const Mat &img0, const Mat &img1, const Matx33d &F, const vector<Point2d> &pts, int pts0or1, int nFeatures = 10, const Matx34d &P = Matx34d::eye());
+    
+    //stops the worker once the queued frames are rendered, or right away if drain is false. Called by the destructor
+    void stop(bool drain = true);
+    
+    VisualizationStats stats() const;
+    
+    //renders frame into canvas at the given scale, as the worker does
+    static void render(const VisualizationFrame &frame, Mat &canvas, float scale = 0.5);
+    
+private:
+    
+    vector<VisualizationFrame> slots;
+    uint64 mask;
+    
+    //head is the next slot to render and only moves on the worker, tail the next slot to fill and only moves on the producer
+    atomic<uint64> head, tail;
+    atomic<uint64> pushed, dropped, rendered;
+    atomic<bool> running, drainOnStop;
+    
+    Sink sink;
+    float scale;
+    thread worker;
+    
+    void run();
+};
+
+#endif /* VisualizationQueue_hpp */
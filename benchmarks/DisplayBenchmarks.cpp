@@ -0,0 +1,227 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+//Display2D micro-benchmarks on 640x480 images with 10 to 100k features
+
+#include <benchmark/benchmark.h>
+#include "Display2D.hpp"
+#include "FrameRecorder.hpp"
+#include "VisualizationQueue.hpp"
+#include "SyntheticScene.hpp"
+
+using namespace std;
+using namespace cv;
+
+//point counts 10, 100, ..., 100k
+#define POINT_SWEEP RangeMultiplier(10)->Range(10, 100000)
+
+static void BM_DisplayFeaturesOnFrame(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Display2D::displayFeaturesOnFrame(s.img0, s.pts0).data);
+    state.SetItemsProcessed(state.iterations()*s.pts0.size());
+}
+BENCHMARK(BM_DisplayFeaturesOnFrame)->POINT_SWEEP;
+
+static void BM_DisplayFeaturesOnFrameFloat(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Display2D::displayFeaturesOnFrame(s.img0, s.pts0f).data);
+    state.SetItemsProcessed(state.iterations()*s.pts0.size());
+}
+BENCHMARK(BM_DisplayFeaturesOnFrameFloat)->POINT_SWEEP;
+
+static void BM_DisplayFeatureMatches(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Display2D::displayFeatureMatches(s.img0, s.img1, s.pts0, s.pts1).data);
+    state.SetItemsProcessed(state.iterations()*s.pts0.size());
+}
+BENCHMARK(BM_DisplayFeatureMatches)->POINT_SWEEP;
+
+static void BM_DisplayFeatureMatchesFloat(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Display2D::displayFeatureMatches(s.img0, s.img1, s.pts0f, s.pts1f).data);
+    state.SetItemsProcessed(state.iterations()*s.pts0.size());
+}
+BENCHMARK(BM_DisplayFeatureMatchesFloat)->POINT_SWEEP;
+
+static void BM_Display3DProjections(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Display2D::display3DProjections(s.img1, s.K, s.R, Matx31d(s.t.val), s.pts3D).data);
+    state.SetItemsProcessed(state.iterations()*s.pts3D.size());
+}
+BENCHMARK(BM_Display3DProjections)->POINT_SWEEP;
+
+//all features get an epipolar line
+static void BM_DisplayEpipolarLines(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Display2D::displayEpipolarLines(s.img0, s.img1, s.F, s.pts0, 0, (int)s.pts0.size()).data);
+    state.SetItemsProcessed(state.iterations()*s.pts0.size());
+}
+BENCHMARK(BM_DisplayEpipolarLines)->POINT_SWEEP;
+
+static void BM_DrawCubeWireframe(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(10);
+    vector<Matx31d> front, back;
+    for (int i = 0; i < 4; i++) {
+        double x = (i == 1 || i == 2) ? 1 : -1, y = (i < 2) ? -1 : 1;
+        front.push_back(Matx31d(x, y, 8));
+        back.push_back(Matx31d(x, y, 10));
+    }
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Display2D::drawCubeWireframe(s.img1, s.K, s.P1, front, back).data);
+}
+BENCHMARK(BM_DrawCubeWireframe);
+
+static void BM_DrawRotatedRectangle(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(10);
+    RotatedRect rect(Point2f(320, 240), Size2f(200, 100), 30);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Display2D::drawRotatedRectangle(s.img0, rect).data);
+}
+BENCHMARK(BM_DrawRotatedRectangle);
+
+//features, projections and a rectangle stacked on one reused canvas
+static void BM_RenderLayersOnCanvas(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    RotatedRect rect(Point2f(320, 240), Size2f(200, 100), 30);
+    Mat canvas;
+    for (auto _ : state) {
+        Display2D::prepareCanvas(s.img1, canvas);
+        Display2D::renderFeatures(canvas, s.pts1);
+        Display2D::renderProjections(canvas, s.cam1, s.cloud.view(), 0.5, 2, Scalar(0,0,255));
+        Display2D::renderRotatedRectangle(canvas, rect);
+        benchmark::DoNotOptimize(canvas.data);
+    }
+    state.SetItemsProcessed(state.iterations()*s.pts1.size());
+}
+BENCHMARK(BM_RenderLayersOnCanvas)->POINT_SWEEP;
+
+static void BM_RenderMatchesOnCanvas(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    Mat canvas, view0, view1;
+    for (auto _ : state) {
+        Display2D::prepareCanvas(s.img0, s.img1, canvas, view0, view1);
+        Display2D::renderMatches(canvas, s.pts0, s.pts1, s.img0.cols);
+        benchmark::DoNotOptimize(canvas.data);
+    }
+    state.SetItemsProcessed(state.iterations()*s.pts0.size());
+}
+BENCHMARK(BM_RenderMatchesOnCanvas)->POINT_SWEEP;
+
+//the same layers recorded into a reused draw list and rasterized in one pass
+static void BM_RenderLayersDrawList(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    RotatedRect rect(Point2f(320, 240), Size2f(200, 100), 30);
+    Mat canvas;
+    DrawList list;
+    for (auto _ : state) {
+        Display2D::prepareCanvas(s.img1, canvas);
+        list.reset(canvas.size());
+        Display2D::renderFeatures(list, s.pts1);
+        Display2D::renderProjections(list, s.cam1, s.cloud.view(), 0.5, 2, Scalar(0,0,255));
+        Display2D::renderRotatedRectangle(list, rect);
+        list.rasterize(canvas);
+        benchmark::DoNotOptimize(canvas.data);
+    }
+    state.SetItemsProcessed(state.iterations()*s.pts1.size());
+}
+BENCHMARK(BM_RenderLayersDrawList)->POINT_SWEEP;
+
+//matches and epipolar lines on a side by side canvas through a draw list, long lines crossing many tiles
+static void BM_RenderMatchesDrawList(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    Mat canvas, view0, view1;
+    DrawList list;
+    for (auto _ : state) {
+        Display2D::prepareCanvas(s.img0, s.img1, canvas, view0, view1);
+        list.reset(canvas.size());
+        Display2D::renderMatches(list, s.pts0, s.pts1, s.img0.cols);
+        list.rasterize(canvas);
+        benchmark::DoNotOptimize(canvas.data);
+    }
+    state.SetItemsProcessed(state.iterations()*s.pts0.size());
+}
+BENCHMARK(BM_RenderMatchesDrawList)->POINT_SWEEP;
+
+static void BM_RenderEpipolarLinesDrawList(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    Mat canvas, view0, view1;
+    DrawList list;
+    for (auto _ : state) {
+        Display2D::prepareCanvas(s.img0, s.img1, canvas, view0, view1);
+        list.reset(canvas.size());
+        Display2D::renderEpipolarLines(list, s.img0.cols, s.F, s.pts0, 0, (int)s.pts0.size());
+        list.rasterize(canvas);
+        benchmark::DoNotOptimize(canvas.data);
+    }
+    state.SetItemsProcessed(state.iterations()*s.pts0.size());
+}
+BENCHMARK(BM_RenderEpipolarLinesDrawList)->POINT_SWEEP;
+
+//cost on the tracking thread of handing matches to the visualization worker, frames dropped when it falls behind
+static void BM_VisualizationQueuePushMatches(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    VisualizationQueue queue((VisualizationQueue::Sink()));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(queue.pushMatches(s.img0, s.img1, s.pts0, s.pts1));
+    queue.stop(false);
+    VisualizationStats stats = queue.stats();
+    state.counters["dropped"] = (double)stats.dropped/stats.pushed;
+}
+BENCHMARK(BM_VisualizationQueuePushMatches)->POINT_SWEEP;
+
+//the 1000 matches with the lowest transfer residual, selection included
+static void BM_RenderMatchesTopK(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<double> residuals(s.pts0.size());
+    for (size_t i = 0; i < s.pts0.size(); i++)
+        residuals[i] = norm(s.pts1[i] - s.pts0[i]);
+    Mat canvas, view0, view1;
+    vector<int> idx;
+    for (auto _ : state) {
+        Display2D::prepareCanvas(s.img0, s.img1, canvas, view0, view1);
+        Display2D::selectMatches(residuals, 1000, idx);
+        Display2D::renderMatches(canvas, s.pts0, s.pts1, idx, s.img0.cols);
+        benchmark::DoNotOptimize(canvas.data);
+    }
+    state.SetItemsProcessed(state.iterations()*s.pts0.size());
+}
+BENCHMARK(BM_RenderMatchesTopK)->POINT_SWEEP;
+
+//writing a 320x240 canvas to a raw ring file, frames dropped when the encoder falls behind
+static void BM_FrameRecorderRaw(benchmark::State &state) {
+    Mat canvas(240, 320, CV_8UC3, Scalar::all(128));
+    FrameRecorder recorder;
+    recorder.open("FrameRecorderBenchmark.raw", FrameRecorder::RAW, 30, 64 << 20, 30);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(recorder.write(canvas));
+    recorder.close();
+    remove("FrameRecorderBenchmark.raw");
+    state.counters["dropped"] = (double)recorder.framesDropped()/state.iterations();
+    state.SetBytesProcessed(state.iterations()*canvas.total()*canvas.elemSize());
+}
+BENCHMARK(BM_FrameRecorderRaw);
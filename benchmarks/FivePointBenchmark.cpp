@@ -0,0 +1,119 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+//Five-point versus eight-point relative pose estimation on synthetic scenes: raw hypotheses per second of each minimal solver, and
+//the number of samples and the time RobustEstimator needs to reach the same success rate as the outlier ratio grows.
+//Built as the FivePointBenchmark target of the benchmarks directory
+
+#include <stdio.h>
+#include <chrono>
+#include "RobustEstimator.hpp"
+#include "SyntheticScene.hpp"
+
+using namespace std;
+using namespace cv;
+
+static const int kPoints = 500;
+static const int kTrials = 50;
+static const double kNoise = 0.5;
+
+static double seconds(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//hypotheses generated per second from random minimal samples
+static double hypothesesPerSecond(const MinimalSolver &solver, const SyntheticScene &scene) {
+    
+    RNG rng(1);
+    vector<Matx33d> models(solver.maxModels());
+    vector<int> sample(solver.sampleSize());
+    long nModels = 0;
+    int nSamples = 20000;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int s = 0; s < nSamples; s++) {
+        for (size_t i = 0; i < sample.size(); i++)
+            sample[i] = rng.uniform(0, kPoints);
+        nModels += solver.fit(&scene.pts0[0], &scene.pts1[0], &sample[0], (int)sample.size(), &models[0]);
+    }
+    return nModels/seconds(start);
+}
+
+int main() {
+    
+    SyntheticScene scene = SyntheticScene::generate(kPoints);
+    
+    FundamentalSolver fundamental;
+    EssentialSolver essential(scene.K, scene.K);
+    FivePointSolver fivePoint(scene.K, scene.K);
+    const MinimalSolver *solvers[] = {&fivePoint, &essential, &fundamental};
+    const char *names[] = {"5-point E", "8-point E", "8-point F"};
+    
+    printf("minimal solver throughput\n");
+    printf("%-10s %16s %14s\n", "solver", "hypotheses/s", "models/sample");
+    for (int s = 0; s < 3; s++) {
+        vector<Matx33d> models(solvers[s]->maxModels());
+        vector<int> sample(solvers[s]->sampleSize());
+        for (size_t i = 0; i < sample.size(); i++)
+            sample[i] = (int)i;
+        printf("%-10s %16.0f %14d\n", names[s], hypothesesPerSecond(*solvers[s], scene), solvers[s]->fit(&scene.pts0[0], &scene.pts1[0], &sample[0], (int)sample.size(), &models[0]));
+    }
+    
+    //a trial succeeds if at least 90% of the true inliers are recovered with at most 5% false inliers
+    printf("\nrobust estimation, %d points, %d trials per outlier ratio, confidence 0.99\n", kPoints, kTrials);
+    printf("%-10s %8s %8s %10s %12s\n", "solver", "outliers", "success", "samples", "ms/estimate");
+    double ratios[] = {0.3, 0.5, 0.7};
+    for (int r = 0; r < 3; r++) {
+        vector<SyntheticScene> scenes(kTrials);
+        for (int k = 0; k < kTrials; k++)
+            scenes[k] = SyntheticScene::generate(kPoints, false, ratios[r], kNoise, 1000*r + k);
+        
+        for (int s = 0; s < 3; s++) {
+            RobustParams params;
+            params.threshold = 2.0;
+            params.maxIterations = 20000;
+            int success = 0;
+            double samples = 0, time = 0;
+            for (int k = 0; k < kTrials; k++) {
+                const SyntheticScene &sc = scenes[k];
+                EssentialSolver e(sc.K, sc.K);
+                FivePointSolver f(sc.K, sc.K);
+                const MinimalSolver *solver = (s == 0) ? (const MinimalSolver *)&f : (s == 1) ? (const MinimalSolver *)&e : solvers[2];
+                
+                RobustResult result;
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                RobustEstimator::estimate(*solver, sc.pts0, sc.pts1, result, params);
+                time += seconds(start);
+                
+                int truePositives = 0, falsePositives = 0, nInliers = 0;
+                for (int i = 0; i < kPoints; i++) {
+                    nInliers += sc.inliers[i];
+                    if (result.inliers.size() && result.inliers[i])
+                        (sc.inliers[i] ? truePositives : falsePositives)++;
+                }
+                success += (truePositives >= 0.9*nInliers) && (falsePositives <= 0.05*nInliers);
+                samples += result.iterations;
+            }
+            printf("%-10s %8.1f %7.0f%% %10.0f %12.2f\n", names[s], ratios[r], 100.0*success/kTrials, samples/kTrials, 1000*time/kTrials);
+        }
+    }
+    return 0;
+}
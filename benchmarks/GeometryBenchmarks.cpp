@@ -0,0 +1,467 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+//GeometryUtils micro-benchmarks over synthetic scenes of 10 to 100k points. Run with
+//  --benchmark_out=results.json --benchmark_out_format=json
+//to keep the results, or build the benchmark_json target
+
+#include <benchmark/benchmark.h>
+#include "SyntheticScene.hpp"
+#include "Refinement.hpp"
+#include "PnP.hpp"
+#include "GridIndex.hpp"
+
+using namespace std;
+using namespace cv;
+
+//point counts 10, 100, ..., 100k
+#define POINT_SWEEP RangeMultiplier(10)->Range(10, 100000)
+
+static void setProcessed(benchmark::State &state, size_t n) {
+    state.SetItemsProcessed(state.iterations()*n);
+}
+
+//triangulation
+static void BM_TriangulatePoints(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<Matx31d> out;
+    for (auto _ : state) {
+        out.clear();
+        GeometryUtils::triangulatePoints(s.P0, s.P1, s.K, s.K, s.pts0, s.pts1, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    setProcessed(state, s.pts0.size());
+}
+BENCHMARK(BM_TriangulatePoints)->POINT_SWEEP;
+
+static void BM_TriangulatePointsFloat(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<Matx31d> out;
+    for (auto _ : state) {
+        out.clear();
+        GeometryUtils::triangulatePoints(s.P0, s.P1, s.K, s.K, s.pts0f, s.pts1f, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    setProcessed(state, s.pts0.size());
+}
+BENCHMARK(BM_TriangulatePointsFloat)->POINT_SWEEP;
+
+static void BM_TriangulatePointsParallel(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<Matx31d> out;
+    for (auto _ : state) {
+        out.clear();
+        GeometryUtils::triangulatePoints(s.P0, s.P1, s.K, s.K, s.pts0, s.pts1, out, 4);
+        benchmark::DoNotOptimize(out.data());
+    }
+    setProcessed(state, s.pts0.size());
+}
+BENCHMARK(BM_TriangulatePointsParallel)->POINT_SWEEP->UseRealTime();
+
+static void BM_TriangulatePointsCloud(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    PointCloud3 out;
+    for (auto _ : state) {
+        out.clear();
+        GeometryUtils::triangulatePoints(s.cam0, s.cam1, s.pts0, s.pts1, out);
+        benchmark::DoNotOptimize(out.x());
+    }
+    setProcessed(state, s.pts0.size());
+}
+BENCHMARK(BM_TriangulatePointsCloud)->POINT_SWEEP;
+
+//rig of nViews cameras 0.3 apart along x, each point of the scene observed by every camera
+static void multiViewTracks(const SyntheticScene &s, int nViews, vector<CameraModel> &cams, TrackTable &tracks) {
+    cams.clear();
+    tracks.clear();
+    for (int c = 0; c < nViews; c++)
+        cams.push_back(CameraModel(s.K, SyntheticScene::rotation(Vec3d(0, 0.02*c, 0)), Matx31d(-0.3*c, 0, 0)));
+    for (size_t i = 0; i < s.pts3D.size(); i++) {
+        for (int c = 0; c < nViews; c++)
+            tracks.addObservation(c, cams[c].projectPoint(s.pts3D[i]));
+        tracks.endTrack();
+    }
+}
+
+//second argument: number of views per track
+static void BM_TriangulateTracks(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<CameraModel> cams;
+    TrackTable tracks;
+    multiViewTracks(s, (int)state.range(1), cams, tracks);
+    PointCloud3 out;
+    vector<double> errors, angles;
+    for (auto _ : state) {
+        out.clear();
+        errors.clear();
+        angles.clear();
+        GeometryUtils::triangulateTracks(cams, tracks, out, &errors, &angles);
+        benchmark::DoNotOptimize(out.x());
+    }
+    setProcessed(state, tracks.size());
+}
+BENCHMARK(BM_TriangulateTracks)->RangeMultiplier(10)->Ranges({{10, 100000}, {3, 10}});
+
+static void BM_TriangulateTracksParallel(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<CameraModel> cams;
+    TrackTable tracks;
+    multiViewTracks(s, 6, cams, tracks);
+    PointCloud3 out;
+    for (auto _ : state) {
+        out.clear();
+        GeometryUtils::triangulateTracks(cams, tracks, out, NULL, NULL, 4);
+        benchmark::DoNotOptimize(out.x());
+    }
+    setProcessed(state, tracks.size());
+}
+BENCHMARK(BM_TriangulateTracksParallel)->POINT_SWEEP->UseRealTime();
+
+//refinement of points triangulated from noisy tracks, the poses fixed
+static void BM_RefinePoints(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<CameraModel> cams;
+    TrackTable tracks;
+    multiViewTracks(s, 6, cams, tracks);
+    RNG rng(0x5eed);
+    for (size_t k = 0; k < tracks.nObservations(); k++)
+        tracks.pts[k] += Point2d(rng.gaussian(0.5), rng.gaussian(0.5));
+    PointCloud3 linear, refined;
+    GeometryUtils::triangulateTracks(cams, tracks, linear);
+    for (auto _ : state) {
+        refined = linear;
+        Refinement::refinePoints(cams, tracks, refined);
+        benchmark::DoNotOptimize(refined.x());
+    }
+    setProcessed(state, tracks.size());
+}
+BENCHMARK(BM_RefinePoints)->POINT_SWEEP;
+
+//bundle adjustment of the poses of the last 4 of 6 views and of the points, from perturbed poses
+static void BM_BundleAdjust(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<CameraModel> cams, perturbed;
+    TrackTable tracks;
+    multiViewTracks(s, 6, cams, tracks);
+    RNG rng(0x5eed);
+    for (size_t k = 0; k < tracks.nObservations(); k++)
+        tracks.pts[k] += Point2d(rng.gaussian(0.5), rng.gaussian(0.5));
+    perturbed = cams;
+    for (size_t c = 2; c < cams.size(); c++) {
+        const Matx34d &P = cams[c].getP();
+        Matx33d R(P(0,0), P(0,1), P(0,2), P(1,0), P(1,1), P(1,2), P(2,0), P(2,1), P(2,2));
+        perturbed[c].setPose(SyntheticScene::rotation(Vec3d(0.005, -0.005, 0.002))*R, Matx31d(P(0,3) + 0.02, P(1,3) - 0.01, P(2,3)));
+    }
+    PointCloud3 linear, pts;
+    GeometryUtils::triangulateTracks(perturbed, tracks, linear);
+    Refinement refinement;
+    RefinementResult result;
+    for (auto _ : state) {
+        vector<CameraModel> adjusted = perturbed;
+        pts = linear;
+        refinement.adjust(adjusted, tracks, pts, Refinement::REFINE_ALL, 2, RefinementParams(), &result);
+        benchmark::DoNotOptimize(pts.x());
+    }
+    state.counters["iterations"] = result.iterations;
+    state.counters["rms"] = sqrt(result.finalCost/result.nObservations);
+    setProcessed(state, tracks.size());
+}
+BENCHMARK(BM_BundleAdjust)->RangeMultiplier(10)->Range(100, 10000);
+
+//pose of view 1 from the scene points and their noisy observations in it, 30% of them outliers, with one PnP workspace reused
+//over the iterations as in frame to frame tracking
+static void BM_PnP(benchmark::State &state) {
+    SyntheticScene s = SyntheticScene::generate(state.range(0), false, 0.3);
+    PnP pnp;
+    PnPResult result;
+    CameraModel intrinsics(s.K);
+    for (auto _ : state) {
+        pnp.estimate(intrinsics, s.imSize, s.cloud.view(), s.pts1, result);
+        benchmark::DoNotOptimize(result.t);
+    }
+    state.counters["iterations"] = result.iterations;
+    state.counters["inliers"] = (double)result.nInliers/s.pts1.size();
+    setProcessed(state, s.pts1.size());
+}
+BENCHMARK(BM_PnP)->RangeMultiplier(10)->Range(100, 100000);
+
+//projection
+static void BM_ProjectPoints(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<Point2d> out;
+    for (auto _ : state) {
+        out.clear();
+        GeometryUtils::projectPoints(s.P1, s.K, s.pts3D, out, s.imSize);
+        benchmark::DoNotOptimize(out.data());
+    }
+    setProcessed(state, s.pts3D.size());
+}
+BENCHMARK(BM_ProjectPoints)->POINT_SWEEP;
+
+static void BM_ProjectPointsInt(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<Point2i> out;
+    for (auto _ : state) {
+        out.clear();
+        GeometryUtils::projectPoints(s.P1, s.K, s.pts3D, out, s.imSize);
+        benchmark::DoNotOptimize(out.data());
+    }
+    setProcessed(state, s.pts3D.size());
+}
+BENCHMARK(BM_ProjectPointsInt)->POINT_SWEEP;
+
+static void BM_ProjectPointsCloud(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<Point2d> out;
+    for (auto _ : state) {
+        out.clear();
+        GeometryUtils::projectPoints(s.cam1, s.cloud.view(), out, s.imSize);
+        benchmark::DoNotOptimize(out.data());
+    }
+    setProcessed(state, s.pts3D.size());
+}
+BENCHMARK(BM_ProjectPointsCloud)->POINT_SWEEP;
+
+//single point projection, as in per map point visibility loops
+static void BM_ProjectPoint(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    for (auto _ : state) {
+        for (size_t i = 0; i < s.pts3D.size(); i++)
+            benchmark::DoNotOptimize(GeometryUtils::projectPoint(s.P1, s.K, s.pts3D[i]));
+    }
+    setProcessed(state, s.pts3D.size());
+}
+BENCHMARK(BM_ProjectPoint)->POINT_SWEEP;
+
+static void BM_CameraModelProjectPoint(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    for (auto _ : state) {
+        for (size_t i = 0; i < s.pts3D.size(); i++)
+            benchmark::DoNotOptimize(s.cam1.projectPoint(s.pts3D[i]));
+    }
+    setProcessed(state, s.pts3D.size());
+}
+BENCHMARK(BM_CameraModelProjectPoint)->POINT_SWEEP;
+
+//spatial grid over the projected points, rebuilt every iteration as once per frame
+static void BM_GridIndexBuild(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    GridIndex grid(s.imSize);
+    for (auto _ : state) {
+        grid.build(s.cam1, s.cloud.view());
+        benchmark::DoNotOptimize(grid.size());
+    }
+    setProcessed(state, s.pts3D.size());
+}
+BENCHMARK(BM_GridIndexBuild)->POINT_SWEEP;
+
+//neighbours within 10 pixels of every observation, against the scan over all points it replaces
+static void BM_GridIndexRadius(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    GridIndex grid(s.imSize);
+    grid.build(s.pts1);
+    vector<int> indices;
+    size_t found = 0;
+    for (auto _ : state) {
+        found = 0;
+        for (size_t i = 0; i < s.pts1.size(); i++)
+            found += grid.radiusSearch(s.pts1[i], 10, indices);
+        benchmark::DoNotOptimize(found);
+    }
+    state.counters["neighbours"] = (double)found/s.pts1.size();
+    setProcessed(state, s.pts1.size());
+}
+BENCHMARK(BM_GridIndexRadius)->POINT_SWEEP;
+
+static void BM_BruteForceRadius(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<int> indices;
+    for (auto _ : state) {
+        for (size_t i = 0; i < s.pts1.size(); i++) {
+            indices.clear();
+            for (size_t j = 0; j < s.pts1.size(); j++) {
+                double dx = s.pts1[j].x - s.pts1[i].x, dy = s.pts1[j].y - s.pts1[i].y;
+                if (dx*dx + dy*dy <= 100)
+                    indices.push_back((int)j);
+            }
+            benchmark::DoNotOptimize(indices.data());
+        }
+    }
+    setProcessed(state, s.pts1.size());
+}
+BENCHMARK(BM_BruteForceRadius)->RangeMultiplier(10)->Range(10, 10000);
+
+static void BM_GridIndexKnn(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    GridIndex grid(s.imSize);
+    grid.build(s.pts1);
+    vector<int> indices;
+    for (auto _ : state) {
+        for (size_t i = 0; i < s.pts1.size(); i++)
+            grid.knnSearch(s.pts1[i], 8, indices);
+        benchmark::DoNotOptimize(indices.data());
+    }
+    setProcessed(state, s.pts1.size());
+}
+BENCHMARK(BM_GridIndexKnn)->POINT_SWEEP;
+
+//outlier filtering
+static void BM_FilterOutliers(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<uchar> status;
+    for (auto _ : state) {
+        status.clear();
+        benchmark::DoNotOptimize(GeometryUtils::filterOutliers(s.P1, s.K, s.imSize, s.pts3D, s.pts1, status));
+    }
+    setProcessed(state, s.pts3D.size());
+}
+BENCHMARK(BM_FilterOutliers)->POINT_SWEEP;
+
+static void BM_FilterOutliersFloat(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<uchar> status;
+    for (auto _ : state) {
+        status.clear();
+        benchmark::DoNotOptimize(GeometryUtils::filterOutliers(s.P1, s.K, s.imSize, s.pts3D, s.pts1f, status));
+    }
+    setProcessed(state, s.pts3D.size());
+}
+BENCHMARK(BM_FilterOutliersFloat)->POINT_SWEEP;
+
+static void BM_FilterOutliersCloud(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<uchar> status;
+    for (auto _ : state) {
+        status.clear();
+        benchmark::DoNotOptimize(GeometryUtils::filterOutliers(s.cam1, s.imSize, s.cloud.view(), s.pts1, status));
+    }
+    setProcessed(state, s.pts3D.size());
+}
+BENCHMARK(BM_FilterOutliersCloud)->POINT_SWEEP;
+
+static void BM_FilterMatches(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<uchar> status;
+    for (auto _ : state) {
+        status.clear();
+        benchmark::DoNotOptimize(GeometryUtils::filterMatches(s.F, s.pts0, s.pts1, status, 2.0));
+    }
+    setProcessed(state, s.pts0.size());
+}
+BENCHMARK(BM_FilterMatches)->POINT_SWEEP;
+
+static void BM_FilterMatchesFloat(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<uchar> status;
+    for (auto _ : state) {
+        status.clear();
+        benchmark::DoNotOptimize(GeometryUtils::filterMatches(s.Ff, s.pts0f, s.pts1f, status, 2.0));
+    }
+    setProcessed(state, s.pts0.size());
+}
+BENCHMARK(BM_FilterMatchesFloat)->POINT_SWEEP;
+
+static void BM_FilterMatches3D(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<Matx31d> pts3D = s.pts3D;
+    vector<uchar> status;
+    for (auto _ : state) {
+        status.clear();
+        benchmark::DoNotOptimize(GeometryUtils::filterMatches(s.F, s.pts0, s.pts1, pts3D, status, 2.0));
+    }
+    setProcessed(state, s.pts0.size());
+}
+BENCHMARK(BM_FilterMatches3D)->POINT_SWEEP;
+
+//pose recovery
+static void BM_RtFromEssentialMatrix(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    Matx33d R;
+    Vec3d t;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(GeometryUtils::RtFromEssentialMatrix(s.E, s.K, s.K, s.pts0, s.pts1, R, t));
+    setProcessed(state, s.pts0.size());
+}
+BENCHMARK(BM_RtFromEssentialMatrix)->POINT_SWEEP;
+
+static void BM_RtFromEssentialMatrixFloat(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    Matx33d R;
+    Vec3d t;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(GeometryUtils::RtFromEssentialMatrix(s.Ef, s.Kf, s.Kf, s.pts0f, s.pts1f, R, t));
+    setProcessed(state, s.pts0.size());
+}
+BENCHMARK(BM_RtFromEssentialMatrixFloat)->POINT_SWEEP;
+
+static void BM_RtFromHomographyMatrix(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0), true);
+    Matx33d R;
+    Vec3d t;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(GeometryUtils::RtFromHomographyMatrix(s.Hf, s.Kf, s.Kf, s.pts0f, s.pts1f, R, t));
+    setProcessed(state, s.pts0.size());
+}
+BENCHMARK(BM_RtFromHomographyMatrix)->POINT_SWEEP;
+
+//error metrics
+static void BM_FundamentalAvgError(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(GeometryUtils::calculateFundamentalAvgError(s.pts0, s.pts1, s.F));
+    setProcessed(state, s.pts0.size());
+}
+BENCHMARK(BM_FundamentalAvgError)->POINT_SWEEP;
+
+static void BM_FundamentalAvgErrorFloat(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(GeometryUtils::calculateFundamentalAvgError(s.pts0f, s.pts1f, s.Ff));
+    setProcessed(state, s.pts0.size());
+}
+BENCHMARK(BM_FundamentalAvgErrorFloat)->POINT_SWEEP;
+
+static void BM_HomographyAvgError(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0), true);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(GeometryUtils::calculateHomographyAvgError(s.pts0, s.pts1, s.H));
+    setProcessed(state, s.pts0.size());
+}
+BENCHMARK(BM_HomographyAvgError)->POINT_SWEEP;
+
+static void BM_HomographyAvgErrorFloat(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0), true);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(GeometryUtils::calculateHomographyAvgError(s.pts0f, s.pts1f, s.Hf));
+    setProcessed(state, s.pts0.size());
+}
+BENCHMARK(BM_HomographyAvgErrorFloat)->POINT_SWEEP;
+
+static void BM_EpipolarResiduals(benchmark::State &state) {
+    const SyntheticScene &s = SyntheticScene::cached(state.range(0));
+    vector<double> residuals(s.pts0.size());
+    for (auto _ : state)
+        benchmark::DoNotOptimize(GeometryUtils::epipolarResiduals(s.F, &s.pts0[0], &s.pts1[0], s.pts0.size(), &residuals[0], NULL, 4.0, state.range(1)));
+    setProcessed(state, s.pts0.size());
+}
+//second argument: EPIPOLAR_SYMMETRIC or EPIPOLAR_SAMPSON
+BENCHMARK(BM_EpipolarResiduals)->RangeMultiplier(10)->Ranges({{10, 100000}, {GeometryUtils::EPIPOLAR_SYMMETRIC, GeometryUtils::EPIPOLAR_SAMPSON}});
@@ -0,0 +1,198 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+//Hashing of (frameId, featureId, level) integer tuple keys: hashing throughput and bucket collisions in a power of two table, and
+//unordered_map lookups, for the former boost style combine and the TupleHash mixers. Then FlatHashMap against unordered_map with the
+//same hash on insertion, lookup and iteration
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "Hashing.h"
+#include "FlatHashMap.hpp"
+
+using namespace std;
+
+typedef tuple<int, int, int> TrackKey;
+
+//key counts 1k, 10k, ..., 1M
+#define KEY_SWEEP RangeMultiplier(10)->Range(1000, 1000000)
+
+//the combine Hashing.h used for tuples before TupleHash
+struct BoostCombineHash {
+    static inline void combine(size_t &seed, int v) {
+        seed ^= hash<int>()(v) + 0x9e3779b9 + (seed<<6) + (seed>>2);
+    }
+    size_t operator()(const TrackKey &k) const {
+        size_t seed = 0;
+        combine(seed, get<0>(k));
+        combine(seed, get<1>(k));
+        combine(seed, get<2>(k));
+        return seed;
+    }
+};
+
+//2000 features per frame on one of 4 pyramid levels
+static vector<TrackKey> trackKeys(size_t n) {
+    vector<TrackKey> keys(n);
+    for (size_t i = 0; i < n; i++)
+        keys[i] = TrackKey((int)(i/2000), (int)(i%2000), (int)((i*7)%4));
+    return keys;
+}
+
+//hashes all keys, and reports the fraction of keys landing in an already occupied bucket of a power of two table with at least as
+//many buckets as keys (indexed by the low bits, as open addressing tables do) and the longest bucket
+template <class Hash>
+static void BM_TupleHashCollisions(benchmark::State &state) {
+    vector<TrackKey> keys = trackKeys(state.range(0));
+    Hash hasher;
+    for (auto _ : state) {
+        size_t acc = 0;
+        for (size_t i = 0; i < keys.size(); i++)
+            acc += hasher(keys[i]);
+        benchmark::DoNotOptimize(acc);
+    }
+    
+    size_t buckets = 1;
+    while (buckets < keys.size())
+        buckets <<= 1;
+    vector<int> counts(buckets, 0);
+    size_t collisions = 0;
+    int longest = 0;
+    for (size_t i = 0; i < keys.size(); i++) {
+        int &c = counts[hasher(keys[i]) & (buckets - 1)];
+        collisions += (c > 0);
+        longest = max(longest, ++c);
+    }
+    state.counters["collisions"] = (double)collisions/keys.size();
+    state.counters["longest"] = longest;
+    state.SetItemsProcessed(state.iterations()*keys.size());
+}
+BENCHMARK_TEMPLATE(BM_TupleHashCollisions, BoostCombineHash)->KEY_SWEEP;
+BENCHMARK_TEMPLATE(BM_TupleHashCollisions, TupleHash<SplitMix64>)->KEY_SWEEP;
+BENCHMARK_TEMPLATE(BM_TupleHashCollisions, TupleHash<WyMix>)->KEY_SWEEP;
+
+//finds every key of a map holding all of them
+template <class Hash>
+static void BM_TupleHashLookup(benchmark::State &state) {
+    vector<TrackKey> keys = trackKeys(state.range(0));
+    unordered_map<TrackKey, int, Hash> map;
+    map.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); i++)
+        map[keys[i]] = (int)i;
+    for (auto _ : state) {
+        long sum = 0;
+        for (size_t i = 0; i < keys.size(); i++)
+            sum += map.find(keys[i])->second;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations()*keys.size());
+}
+BENCHMARK_TEMPLATE(BM_TupleHashLookup, BoostCombineHash)->KEY_SWEEP;
+BENCHMARK_TEMPLATE(BM_TupleHashLookup, TupleHash<SplitMix64>)->KEY_SWEEP;
+BENCHMARK_TEMPLATE(BM_TupleHashLookup, TupleHash<WyMix>)->KEY_SWEEP;
+
+typedef unordered_map<TrackKey, int, TupleHash<> > StdTrackMap;
+typedef FlatHashMap<TrackKey, int> FlatTrackMap;
+
+static inline const int *lookup(const StdTrackMap &map, const TrackKey &key) {
+    StdTrackMap::const_iterator it = map.find(key);
+    return (it == map.end()) ? NULL : &it->second;
+}
+
+static inline const int *lookup(const FlatTrackMap &map, const TrackKey &key) {
+    return map.find(key);
+}
+
+//builds a reserved map of all keys
+template <class Map>
+static void BM_TrackMapInsert(benchmark::State &state) {
+    vector<TrackKey> keys = trackKeys(state.range(0));
+    for (auto _ : state) {
+        Map map;
+        map.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); i++)
+            map.insert(make_pair(keys[i], (int)i));
+        benchmark::DoNotOptimize(map.size());
+    }
+    state.SetItemsProcessed(state.iterations()*keys.size());
+}
+template <>
+void BM_TrackMapInsert<FlatTrackMap>(benchmark::State &state) {
+    vector<TrackKey> keys = trackKeys(state.range(0));
+    for (auto _ : state) {
+        FlatTrackMap map;
+        map.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); i++)
+            map.insert(keys[i], (int)i);
+        benchmark::DoNotOptimize(map.size());
+    }
+    state.SetItemsProcessed(state.iterations()*keys.size());
+}
+BENCHMARK_TEMPLATE(BM_TrackMapInsert, StdTrackMap)->KEY_SWEEP;
+BENCHMARK_TEMPLATE(BM_TrackMapInsert, FlatTrackMap)->KEY_SWEEP;
+
+//finds every key of the frames in a shuffled order, then as many keys of frames that were never inserted
+template <class Map>
+static void BM_TrackMapLookup(benchmark::State &state) {
+    vector<TrackKey> keys = trackKeys(state.range(0));
+    Map map;
+    for (size_t i = 0; i < keys.size(); i++)
+        map[keys[i]] = (int)i;
+    shuffle(keys.begin(), keys.end(), mt19937(42));
+    vector<TrackKey> missing(keys.size());
+    for (size_t i = 0; i < keys.size(); i++)
+        missing[i] = TrackKey(-1 - get<0>(keys[i]), get<1>(keys[i]), get<2>(keys[i]));
+    for (auto _ : state) {
+        long sum = 0;
+        for (size_t i = 0; i < keys.size(); i++)
+            sum += *lookup(map, keys[i]);
+        for (size_t i = 0; i < missing.size(); i++)
+            sum += (lookup(map, missing[i]) != NULL);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations()*keys.size()*2);
+}
+BENCHMARK_TEMPLATE(BM_TrackMapLookup, StdTrackMap)->KEY_SWEEP;
+BENCHMARK_TEMPLATE(BM_TrackMapLookup, FlatTrackMap)->KEY_SWEEP;
+
+//visits every entry of a map that had a third of its entries erased
+template <class Map>
+static void BM_TrackMapIterate(benchmark::State &state) {
+    vector<TrackKey> keys = trackKeys(state.range(0));
+    Map map;
+    for (size_t i = 0; i < keys.size(); i++)
+        map[keys[i]] = (int)i;
+    for (size_t i = 0; i < keys.size(); i += 3)
+        map.erase(keys[i]);
+    for (auto _ : state) {
+        long sum = 0;
+        for (auto &entry : map)
+            sum += entry.second + get<1>(entry.first);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations()*map.size());
+}
+BENCHMARK_TEMPLATE(BM_TrackMapIterate, StdTrackMap)->KEY_SWEEP;
+BENCHMARK_TEMPLATE(BM_TrackMapIterate, FlatTrackMap)->KEY_SWEEP;
@@ -0,0 +1,98 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#include "SyntheticScene.hpp"
+#include <map>
+
+Matx33d SyntheticScene::rotation(const Vec3d &w) {
+    
+    double theta = norm(w);
+    if (theta < DBL_EPSILON)
+        return Matx33d::eye();
+    
+    //Rodrigues' formula
+    Vec3d k = w*(1.0/theta);
+    Matx33d Kx = GeometryUtils::getSkewSymmetric(Matx31d(k(0), k(1), k(2)));
+    return Matx33d::eye() + sin(theta)*Kx + (1 - cos(theta))*Kx*Kx;
+}
+
+SyntheticScene SyntheticScene::generate(size_t n, bool planar, double outlierRatio, double noise, uint64 seed) {
+    
+    RNG rng(seed);
+    SyntheticScene s;
+    s.imSize = Size(640, 480);
+    s.K = Matx33d(500, 0, 320, 0, 500, 240, 0, 0, 1);
+    s.R = rotation(Vec3d(rng.gaussian(0.1), rng.gaussian(0.1), rng.gaussian(0.1)));
+    s.t = Vec3d(-1, rng.gaussian(0.1), rng.gaussian(0.1));
+    s.t *= 1.0/norm(s.t);
+    s.P0 = Matx34d::eye();
+    s.P1 = CameraModel::poseMatrix(s.R, Matx31d(s.t.val));
+    s.cam0 = CameraModel(s.K, s.P0);
+    s.cam1 = CameraModel(s.K, s.P1);
+    
+    //plane n^T*X = d seen by view 0
+    Vec3d normal(0.2, 0, 1);
+    normal *= 1.0/norm(normal);
+    double d = 8*normal(2);
+    
+    Matx33d Kinv = s.K.inv();
+    Matx31d tm(s.t.val);
+    s.E = GeometryUtils::getSkewSymmetric(tm)*s.R;
+    s.F = Kinv.t()*s.E*Kinv;
+    s.H = s.K*(s.R + tm*Matx13d(normal(0), normal(1), normal(2))*(1.0/d))*Kinv;
+    s.Kf = s.K;
+    s.Ef = s.E;
+    s.Ff = s.F;
+    s.Hf = s.H;
+    
+    for (size_t i = 0; i < n; i++) {
+        //back project a random pixel of image 0
+        Matx31d ray = Kinv*Matx31d(rng.uniform(0.0, (double)s.imSize.width), rng.uniform(0.0, (double)s.imSize.height), 1.0);
+        double depth = planar ? d/normal.dot(Vec3d(ray(0), ray(1), ray(2))) : rng.uniform(4.0, 20.0);
+        Matx31d X = ray*depth;
+        s.pts3D.push_back(X);
+        
+        Point2d p0 = s.cam0.projectPoint(X), p1 = s.cam1.projectPoint(X);
+        bool outlier = rng.uniform(0.0, 1.0) < outlierRatio;
+        s.pts0.push_back(Point2d(p0.x + rng.gaussian(noise), p0.y + rng.gaussian(noise)));
+        if (outlier)
+            s.pts1.push_back(Point2d(rng.uniform(0.0, (double)s.imSize.width), rng.uniform(0.0, (double)s.imSize.height)));
+        else
+            s.pts1.push_back(Point2d(p1.x + rng.gaussian(noise), p1.y + rng.gaussian(noise)));
+        s.pts0f.push_back(Point2f(s.pts0.back()));
+        s.pts1f.push_back(Point2f(s.pts1.back()));
+        s.inliers.push_back(!outlier);
+    }
+    s.cloud.fromMatx(s.pts3D);
+    
+    s.img0 = Mat(s.imSize, CV_8UC3, Scalar::all(128));
+    s.img1 = Mat(s.imSize, CV_8UC3, Scalar::all(96));
+    return s;
+}
+
+const SyntheticScene &SyntheticScene::cached(size_t n, bool planar) {
+    static map<pair<size_t, bool>, SyntheticScene> scenes;
+    pair<size_t, bool> key(n, planar);
+    if (scenes.find(key) == scenes.end())
+        scenes[key] = generate(n, planar);
+    return scenes[key];
+}
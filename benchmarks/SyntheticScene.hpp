@@ -0,0 +1,58 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+#ifndef SyntheticScene_hpp
+#define SyntheticScene_hpp
+
+#include <stdio.h>
+#include "GeometryUtils.hpp"
+
+using namespace std;
+using namespace cv;
+
+//Reproducible two-view scene for benchmarks: view 0 is [I|0], view 1 is [R|t] with a unit baseline, and every 3D point projects
+//inside image 0. Planar scenes put the points on a tilted plane so that H is exact. The same seed always gives the same scene
+struct SyntheticScene {
+    Size imSize;
+    Matx33d K, R, E, F, H;
+    Matx33f Kf, Ef, Ff, Hf;
+    Vec3d t;
+    Matx34d P0, P1;
+    CameraModel cam0, cam1;
+    
+    vector<Matx31d> pts3D;
+    PointCloud3 cloud;
+    vector<Point2d> pts0, pts1;         //noisy observations, pts1 replaced by random points for outliers
+    vector<Point2f> pts0f, pts1f;
+    vector<uchar> inliers;
+    Mat img0, img1;
+    
+    static SyntheticScene generate(size_t n, bool planar = false, double outlierRatio = 0.0, double noise = 0.5, uint64 seed = 0x5eed);
+    
+    //scene generated once per (n, planar) with the default parameters
+    static const SyntheticScene &cached(size_t n, bool planar = false);
+    
+    //rotation matrix of the rotation vector w
+    static Matx33d rotation(const Vec3d &w);
+};
+
+#endif /* SyntheticScene_hpp */
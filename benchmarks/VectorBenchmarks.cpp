@@ -0,0 +1,203 @@
+/*******************************************************************************
+ * Copyright (c) 2017  IBM Corporation, Carnegie Mellon University and others
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *******************************************************************************/
+
+//VectorUtils argsort micro-benchmarks on normally distributed reprojection-error-like arrays of 1k to 1M values, and permutation of
+//the parallel arrays of a feature track table and their compaction by a status mask
+
+#include <benchmark/benchmark.h>
+#include <array>
+#include <random>
+#include "VectorUtils.hpp"
+
+using namespace std;
+
+//value counts 1k, 10k, ..., 1M
+#define SIZE_SWEEP RangeMultiplier(10)->Range(1000, 1000000)
+
+template <typename T>
+static vector<T> randomValues(size_t n) {
+    mt19937_64 rng(0x5eed);
+    normal_distribution<double> dist(0, 2);
+    vector<T> v(n);
+    for (size_t i = 0; i < n; i++)
+        v[i] = (T)fabs(dist(rng));
+    return v;
+}
+
+//the indirect comparison argsort sort_indexes used to be
+static void BM_ArgsortIndirect(benchmark::State &state) {
+    vector<double> v = randomValues<double>(state.range(0));
+    for (auto _ : state) {
+        vector<size_t> idx(v.size());
+        iota(idx.begin(), idx.end(), 0);
+        sort(idx.begin(), idx.end(), [&v](size_t i1, size_t i2) { return v[i1] < v[i2]; });
+        benchmark::DoNotOptimize(idx.data());
+    }
+    state.SetItemsProcessed(state.iterations()*v.size());
+}
+BENCHMARK(BM_ArgsortIndirect)->SIZE_SWEEP;
+
+static void BM_SortIndexes(benchmark::State &state) {
+    vector<double> v = randomValues<double>(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(VectorUtils::sort_indexes(v).data());
+    state.SetItemsProcessed(state.iterations()*v.size());
+}
+BENCHMARK(BM_SortIndexes)->SIZE_SWEEP;
+
+static void BM_RadixSortIndexes(benchmark::State &state) {
+    vector<double> v = randomValues<double>(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(VectorUtils::radix_sort_indexes(v).data());
+    state.SetItemsProcessed(state.iterations()*v.size());
+}
+BENCHMARK(BM_RadixSortIndexes)->SIZE_SWEEP;
+
+static void BM_RadixSortIndexesFloat(benchmark::State &state) {
+    vector<float> v = randomValues<float>(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(VectorUtils::radix_sort_indexes(v).data());
+    state.SetItemsProcessed(state.iterations()*v.size());
+}
+BENCHMARK(BM_RadixSortIndexesFloat)->SIZE_SWEEP;
+
+static void BM_ParallelSortIndexes(benchmark::State &state) {
+    vector<double> v = randomValues<double>(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(VectorUtils::parallel_sort_indexes(v, 4).data());
+    state.SetItemsProcessed(state.iterations()*v.size());
+}
+BENCHMARK(BM_ParallelSortIndexes)->SIZE_SWEEP->UseRealTime();
+
+//the 1000 smallest values, sorted
+static void BM_PartialSortIndexes(benchmark::State &state) {
+    vector<double> v = randomValues<double>(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(VectorUtils::partial_sort_indexes(v, 1000).data());
+    state.SetItemsProcessed(state.iterations()*v.size());
+}
+BENCHMARK(BM_PartialSortIndexes)->SIZE_SWEEP;
+
+//2D points, 3D points, status and scores of n features, permuted by a random order
+struct FeatureArrays {
+    vector<size_t> order;
+    vector<array<float, 2> > pts2D;
+    vector<array<double, 3> > pts3D;
+    vector<uint8_t> status;
+    vector<double> scores;
+    
+    FeatureArrays(size_t n) : order(n), pts2D(n), pts3D(n), status(n), scores(randomValues<double>(n)) {
+        iota(order.begin(), order.end(), 0);
+        shuffle(order.begin(), order.end(), mt19937_64(0x5eed));
+    }
+};
+
+//one cycle-leader pass per array
+static void BM_ReorderIndexPerArray(benchmark::State &state) {
+    FeatureArrays f(state.range(0));
+    for (auto _ : state) {
+        VectorUtils::reorder_index(f.order.begin(), f.order.end(), f.pts2D.begin());
+        VectorUtils::reorder_index(f.order.begin(), f.order.end(), f.pts3D.begin());
+        VectorUtils::reorder_index(f.order.begin(), f.order.end(), f.status.begin());
+        VectorUtils::reorder_index(f.order.begin(), f.order.end(), f.scores.begin());
+    }
+    state.SetItemsProcessed(state.iterations()*f.order.size());
+}
+BENCHMARK(BM_ReorderIndexPerArray)->RangeMultiplier(10)->Range(1000, 100000);
+
+static void BM_ReorderArrays(benchmark::State &state) {
+    FeatureArrays f(state.range(0));
+    for (auto _ : state)
+        VectorUtils::reorder_arrays(f.order.begin(), f.order.end(), f.pts2D.begin(), f.pts3D.begin(), f.status.begin(), f.scores.begin());
+    state.SetItemsProcessed(state.iterations()*f.order.size());
+}
+BENCHMARK(BM_ReorderArrays)->SIZE_SWEEP;
+
+static void BM_ReorderArraysBlocked(benchmark::State &state) {
+    FeatureArrays f(state.range(0));
+    for (auto _ : state)
+        VectorUtils::reorder_arrays_blocked(f.order.begin(), f.order.end(), f.pts2D.begin(), f.pts3D.begin(), f.status.begin(), f.scores.begin());
+    state.SetItemsProcessed(state.iterations()*f.order.size());
+}
+BENCHMARK(BM_ReorderArraysBlocked)->SIZE_SWEEP;
+
+//x, y and depth of n features with a status mask keeping 70% of them. The compaction benchmarks include restoring the arrays
+struct MaskedArrays {
+    vector<uint8_t> status;
+    vector<float> x, y;
+    vector<double> z;
+    vector<float> xc, yc;
+    vector<double> zc;
+    
+    MaskedArrays(size_t n) : status(n), x(n), y(n), z(randomValues<double>(n)) {
+        mt19937_64 rng(0x5eed);
+        for (size_t i = 0; i < n; i++)
+            status[i] = (rng() % 10) < 7;
+    }
+    void restore() {
+        xc = x;
+        yc = y;
+        zc = z;
+    }
+};
+
+static void BM_CompactBranching(benchmark::State &state) {
+    MaskedArrays m(state.range(0));
+    for (auto _ : state) {
+        m.restore();
+        size_t j = 0;
+        for (size_t i = 0; i < m.status.size(); i++) {
+            if (m.status[i]) {
+                m.xc[j] = m.xc[i];
+                m.yc[j] = m.yc[i];
+                m.zc[j] = m.zc[i];
+                j++;
+            }
+        }
+        m.xc.resize(j);
+        m.yc.resize(j);
+        m.zc.resize(j);
+        benchmark::DoNotOptimize(m.xc.data());
+    }
+    state.SetItemsProcessed(state.iterations()*m.status.size());
+}
+BENCHMARK(BM_CompactBranching)->SIZE_SWEEP;
+
+static void BM_Compact(benchmark::State &state) {
+    MaskedArrays m(state.range(0));
+    for (auto _ : state) {
+        m.restore();
+        benchmark::DoNotOptimize(VectorUtils::compact(m.status, m.xc, m.yc, m.zc));
+    }
+    state.SetItemsProcessed(state.iterations()*m.status.size());
+}
+BENCHMARK(BM_Compact)->SIZE_SWEEP;
+
+static void BM_CompactParallel(benchmark::State &state) {
+    MaskedArrays m(state.range(0));
+    for (auto _ : state) {
+        m.restore();
+        benchmark::DoNotOptimize(VectorUtils::compact_parallel(m.status, 4, m.xc, m.yc, m.zc).data());
+    }
+    state.SetItemsProcessed(state.iterations()*m.status.size());
+}
+BENCHMARK(BM_CompactParallel)->SIZE_SWEEP->UseRealTime();